@@ -0,0 +1,215 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// BidirectionalFMIndex - a pair of FM-indices, one of
+// the text and one of the reversed text, that can
+// extend a pattern in both directions
+//
+#include <stdlib.h>
+#include <iostream>
+#include "bidirectional_fm_index.h"
+
+//
+BidirectionalFMIndex::BidirectionalFMIndex(const FMIndex* p_forward, const FMIndex* p_reverse, size_t k) : mp_forward(p_forward),
+                                                                                                          mp_reverse(p_reverse),
+                                                                                                          m_k(k)
+{
+    if(p_forward->getBWLen() != p_reverse->getBWLen() || p_forward->getNumStrings() != p_reverse->getNumStrings())
+    {
+        std::cerr << "Error: the reverse index does not match the forward index\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if(k == 1)
+    {
+        std::cerr << "Error: contraction requires k of at least 2\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if(k > 0)
+    {
+        buildBoundaries(p_forward, k - 1, m_forwardBoundaries);
+        buildBoundaries(p_reverse, k - 1, m_reverseBoundaries);
+    }
+}
+
+//
+BiInterval BidirectionalFMIndex::getFullInterval() const
+{
+    BiInterval interval;
+    interval.size = mp_forward->getBWLen();
+    return interval;
+}
+
+//
+BiInterval BidirectionalFMIndex::findInterval(const std::string& s) const
+{
+    BiInterval interval = getFullInterval();
+    for(size_t j = s.size(); j > 0; --j)
+    {
+        if(!extendLeft(interval, s[j - 1]))
+            return BiInterval();
+    }
+    return interval;
+}
+
+//
+bool BidirectionalFMIndex::extendLeft(BiInterval& interval, char c) const
+{
+    return extend(mp_forward, interval.lower, interval.rev_lower, interval.size, c);
+}
+
+//
+bool BidirectionalFMIndex::extendRight(BiInterval& interval, char c) const
+{
+    return extend(mp_reverse, interval.rev_lower, interval.lower, interval.size, c);
+}
+
+//
+void BidirectionalFMIndex::contractLeft(BiInterval& interval) const
+{
+    assert(m_k > 0 && !interval.isEmpty());
+
+    // The reversed k-mer loses its last symbol so its (k-1)-mer block contains it
+    size_t rev_start = getBlockStart(m_reverseBoundaries, interval.rev_lower);
+    interval.size = getBlockSize(m_reverseBoundaries, rev_start);
+    interval.rev_lower = rev_start;
+
+    // The suffix after an occurrence of the k-mer starts with the (k-1)-mer
+    interval.lower = getBlockStart(m_forwardBoundaries, psi(mp_forward, interval.lower));
+}
+
+//
+void BidirectionalFMIndex::contractRight(BiInterval& interval) const
+{
+    assert(m_k > 0 && !interval.isEmpty());
+    size_t start = getBlockStart(m_forwardBoundaries, interval.lower);
+    interval.size = getBlockSize(m_forwardBoundaries, start);
+    interval.lower = start;
+    interval.rev_lower = getBlockStart(m_reverseBoundaries, psi(mp_reverse, interval.rev_lower));
+}
+
+//
+bool BidirectionalFMIndex::slideRight(BiInterval& interval, char c) const
+{
+    contractLeft(interval);
+    return extendRight(interval, c);
+}
+
+//
+bool BidirectionalFMIndex::slideLeft(BiInterval& interval, char c) const
+{
+    contractRight(interval);
+    return extendLeft(interval, c);
+}
+
+//
+bool BidirectionalFMIndex::extend(const FMIndex* index, size_t& lower, size_t& mirror_lower, size_t& size, char c)
+{
+    assert(c != '$');
+    if(size == 0)
+        return false;
+
+    // The symbols preceding P in the text follow reverse(P) in the reversed text
+    AlphaCount64 occ0, occ1;
+    index->getFullOccPair(lower - 1, lower + size - 1, occ0, occ1);
+    AlphaCount64 extensions = occ1 - occ0;
+
+    // The end marker is counted as a '$' here which keeps the order
+    // as both sort before every base
+    size_t rank = BWT_ALPHABET::getRank(c);
+    for(size_t i = 0; i < rank; ++i)
+        mirror_lower += extensions.getByIdx(i);
+
+    lower = index->getPC(c) + occ0.get(c);
+    size = extensions.get(c);
+    return size > 0;
+}
+
+//
+size_t BidirectionalFMIndex::getBlockStart(const RankBitVector& boundaries, size_t idx)
+{
+    return boundaries.prev1(idx);
+}
+
+//
+size_t BidirectionalFMIndex::getBlockSize(const RankBitVector& boundaries, size_t start)
+{
+    return boundaries.next1(start + 1) - start;
+}
+
+//
+size_t BidirectionalFMIndex::psi(const FMIndex* index, size_t idx)
+{
+    char c = index->getF(idx);
+    return index->select(c, idx - index->getPC(c));
+}
+
+// The blocks are found by a breadth-first traversal of the intervals of
+// the substrings shorter than depth, as in Beller et al's construction
+// of the LCP array from the bwt. Every interval marks the row after it,
+// and an interval is only extended further if that row was not marked
+// before, which bounds the work by the number of rows.
+void BidirectionalFMIndex::buildBoundaries(const FMIndex* index, size_t depth, RankBitVector& boundaries)
+{
+    typedef std::pair<size_t, size_t> Interval;
+    size_t n = index->getBWLen();
+    size_t eof_pos = index->getEOFPos();
+    std::vector<bool> is_boundary(n + 1, false);
+
+    // Row 0 is the suffix holding only the end marker, which is a block by itself.
+    // It is a child of the empty string like the intervals of the symbols. Its own
+    // children are the suffixes at the end of the text, which end at the marker.
+    is_boundary[0] = true;
+    is_boundary[1] = true;
+
+    std::vector<Interval> curr(1, Interval(0, n - 1));
+    std::vector<Interval> next;
+    if(depth > 1)
+        next.push_back(Interval(0, 0));
+    for(size_t d = 0; d < depth && !curr.empty(); ++d)
+    {
+        for(size_t i = 0; i < curr.size(); ++i)
+        {
+            size_t lower = curr[i].first;
+            size_t upper = curr[i].second;
+
+            // The end marker is stored as a '$' so it is removed from the counts
+            AlphaCount64 occ0, occ1;
+            index->getFullOccPair(lower - 1, upper, occ0, occ1);
+            occ0.set('$', occ0.get('$') - (eof_pos < lower));
+            occ1.set('$', occ1.get('$') - (eof_pos <= upper));
+
+            for(size_t j = 0; j < BWT_ALPHABET::size; ++j)
+            {
+                size_t count = occ1.getByIdx(j) - occ0.getByIdx(j);
+                if(count == 0)
+                    continue;
+
+                char c = BWT_ALPHABET::getChar(j);
+                size_t child_lower = index->getPC(c) + occ0.getByIdx(j);
+                size_t child_upper = child_lower + count - 1;
+                if(!is_boundary[child_upper + 1])
+                {
+                    is_boundary[child_upper + 1] = true;
+                    if(d + 1 < depth)
+                        next.push_back(Interval(child_lower, child_upper));
+                }
+            }
+        }
+        curr.swap(next);
+        next.clear();
+    }
+    is_boundary[n] = true;
+
+    boundaries.initialize(n + 1);
+    for(size_t i = 0; i <= n; ++i)
+    {
+        if(is_boundary[i])
+            boundaries.set(i);
+    }
+    boundaries.finalize();
+}
@@ -0,0 +1,111 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// BidirectionalFMIndex - a pair of FM-indices, one of
+// the text and one of the reversed text, that can
+// extend a pattern in both directions.
+//
+// A string P is represented by its interval in the
+// forward index together with the interval of reverse(P)
+// in the reverse index. The intervals have the same size.
+// Extending P on the left is a backward step in the
+// forward index. The reverse interval is updated by
+// counting the symbols that precede P, as the suffixes
+// of reverse(P)c are ordered by c. Extending on the
+// right is the mirror image, so both directions cost
+// one fused rank pair.
+//
+// Contracting a k-mer to a (k-1)-mer uses a bitvector
+// per index marking where each block of suffixes with
+// the same (k-1)-prefix begins. These are built for the
+// k given to the constructor. The contracted side is
+// found with the bitvector. The other side is found by
+// mapping a suffix of P to the suffix one position later
+// in the text, which takes a select on the bwt.
+//
+#ifndef BIDIRECTIONAL_FM_INDEX_H
+#define BIDIRECTIONAL_FM_INDEX_H
+
+#include <string>
+#include "fm_index.h"
+#include "rank_bit_vector.h"
+
+// The intervals of a string in the forward and reverse indices
+struct BiInterval
+{
+    BiInterval() : lower(0), rev_lower(0), size(0) {}
+
+    inline bool isEmpty() const { return size == 0; }
+    inline size_t upper() const { return lower + size - 1; }
+    inline size_t rev_upper() const { return rev_lower + size - 1; }
+
+    size_t lower;
+    size_t rev_lower;
+    size_t size;
+};
+
+class BidirectionalFMIndex
+{
+    public:
+
+        // p_forward indexes the text and p_reverse indexes the reversed text.
+        // The indices are not owned. If k is non-zero the bitvectors needed
+        // to contract k-mers are built, which requires a pass over every
+        // distinct substring of length less than k.
+        BidirectionalFMIndex(const FMIndex* p_forward, const FMIndex* p_reverse, size_t k = 0);
+
+        // Return the interval of the empty string, which contains every suffix
+        BiInterval getFullInterval() const;
+
+        // Return the interval of s. The interval is empty if s does not occur.
+        BiInterval findInterval(const std::string& s) const;
+
+        // Update the interval of P to that of cP or Pc and return whether
+        // it is non-empty. c must be one of A, C, G or T.
+        bool extendLeft(BiInterval& interval, char c) const;
+        bool extendRight(BiInterval& interval, char c) const;
+
+        // Update the interval of a k-mer aX to that of X, or of Xa to X.
+        // The k-mer must occur and k is the value given to the constructor.
+        void contractLeft(BiInterval& interval) const;
+        void contractRight(BiInterval& interval) const;
+
+        // Move the interval of the k-mer aX to the k-mer Xc, or of Xa to cX,
+        // and return whether it is non-empty
+        bool slideRight(BiInterval& interval, char c) const;
+        bool slideLeft(BiInterval& interval, char c) const;
+
+        inline size_t getK() const { return m_k; }
+        inline const FMIndex* getForward() const { return mp_forward; }
+        inline const FMIndex* getReverse() const { return mp_reverse; }
+
+    private:
+
+        // Move an interval in index by prepending c. The interval in
+        // mirror is moved past the extensions smaller than c.
+        static bool extend(const FMIndex* index, size_t& lower, size_t& mirror_lower, size_t& size, char c);
+
+        // Return the start of the block of suffixes sharing the (k-1)-prefix
+        // of the suffix at row idx, and the size of the block starting at row start
+        static size_t getBlockStart(const RankBitVector& boundaries, size_t idx);
+        static size_t getBlockSize(const RankBitVector& boundaries, size_t start);
+
+        // Return the row of the suffix that follows the suffix at row idx in the text
+        static size_t psi(const FMIndex* index, size_t idx);
+
+        // Mark the start of each block of suffixes with the same prefix of the given depth
+        static void buildBoundaries(const FMIndex* index, size_t depth, RankBitVector& boundaries);
+
+        const FMIndex* mp_forward;
+        const FMIndex* mp_reverse;
+        size_t m_k;
+
+        // The (k-1)-mer block boundaries of each index. Bit n is always set.
+        RankBitVector m_forwardBoundaries;
+        RankBitVector m_reverseBoundaries;
+};
+
+#endif
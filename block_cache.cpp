@@ -0,0 +1,228 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// BlockCache - a fixed-size cache of decoded blocks
+// of the huffman-coded bwt
+//
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+#include "block_cache.h"
+
+// Round n up to a power of two
+static size_t roundUpPow2(size_t n)
+{
+    size_t p = 1;
+    while(p < n)
+        p <<= 1;
+    return p;
+}
+
+// Mix the bits of a key so neighboring blocks land in different shards
+static inline uint64_t hashKey(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+//
+bool DecodedBlock::assign(const char* symbols, size_t num_symbols, const AlphaCount64& before)
+{
+    assert(num_symbols <= BLOCK_CACHE_MAX_SYMBOLS);
+    counts = before;
+    memset(planes, 0, sizeof(planes));
+    for(size_t i = 0; i < num_symbols; ++i)
+    {
+        int code = BWT_ALPHABET::getRank(symbols[i]) - 1;
+        if(code < 0)
+            return false;
+        planes[2 * (i >> 6)] |= (uint64_t)(code & 1) << (i & 63);
+        planes[2 * (i >> 6) + 1] |= (uint64_t)(code >> 1) << (i & 63);
+    }
+    return true;
+}
+
+//
+BlockCache::BlockCache(size_t num_bytes, size_t num_shards)
+{
+    m_numShards = roundUpPow2(num_shards > 0 ? num_shards : 1);
+    m_shardEntries = roundUpPow2(num_bytes / sizeof(Entry) / m_numShards);
+    if(m_shardEntries < BLOCK_CACHE_PROBE)
+        m_shardEntries = BLOCK_CACHE_PROBE;
+
+    // The probe window of the last slots wraps to the start of the shard
+    m_entries.resize(m_numShards * m_shardEntries);
+    memset(&m_entries[0], 0, m_entries.size() * sizeof(Entry));
+
+    m_shards.resize(m_numShards);
+    for(size_t i = 0; i < m_numShards; ++i)
+    {
+        memset(&m_shards[i], 0, sizeof(Shard));
+        m_shards[i].p_entries = &m_entries[i * m_shardEntries];
+    }
+}
+
+//
+bool BlockCache::find(size_t block_idx, DecodedBlock& block)
+{
+    uint64_t key = block_idx + 1;
+    uint64_t hash = hashKey(key);
+    Shard& shard = getShard(hash);
+    size_t slot = getSlot(hash);
+
+    Entry* p_found = NULL;
+    while(true)
+    {
+        uint32_t version = shard.version;
+        if(version & 1)
+        {
+            // Let the writer finish, in case it shares our processor
+            sched_yield();
+            continue;
+        }
+        __sync_synchronize();
+
+        p_found = NULL;
+        for(size_t i = 0; i < BLOCK_CACHE_PROBE; ++i)
+        {
+            Entry* p_entry = &shard.p_entries[(slot + i) & (m_shardEntries - 1)];
+            if(p_entry->key == key)
+            {
+                block = p_entry->block;
+                p_found = p_entry;
+                break;
+            }
+        }
+
+        // The copy is only valid if no entry was written while it was made
+        __sync_synchronize();
+        if(shard.version == version)
+            break;
+    }
+
+    if(p_found != NULL)
+    {
+        // A mark set on an entry that was replaced since is harmless
+        p_found->referenced = 1;
+        __sync_fetch_and_add(&shard.hits, 1);
+        return true;
+    }
+    __sync_fetch_and_add(&shard.misses, 1);
+    return false;
+}
+
+//
+void BlockCache::insert(size_t block_idx, const DecodedBlock& block)
+{
+    uint64_t key = block_idx + 1;
+    uint64_t hash = hashKey(key);
+    Shard& shard = getShard(hash);
+    size_t slot = getSlot(hash);
+
+    lock(shard);
+    ++shard.version;
+    __sync_synchronize();
+
+    // Use the slot holding the key or the first empty one
+    Entry* p_target = NULL;
+    for(size_t i = 0; i < BLOCK_CACHE_PROBE; ++i)
+    {
+        Entry* p_entry = &shard.p_entries[(slot + i) & (m_shardEntries - 1)];
+        if(p_entry->key == key || p_entry->key == 0)
+        {
+            p_target = p_entry;
+            break;
+        }
+    }
+
+    // Otherwise sweep the window from the hand, giving referenced entries
+    // a second chance. After one pass every mark is clear so this ends.
+    while(p_target == NULL)
+    {
+        Entry* p_entry = &shard.p_entries[(slot + shard.hand++ % BLOCK_CACHE_PROBE) & (m_shardEntries - 1)];
+        if(p_entry->referenced)
+            p_entry->referenced = 0;
+        else
+            p_target = p_entry;
+    }
+
+    if(p_target->key != key)
+    {
+        if(p_target->key != 0)
+            ++shard.evictions;
+        ++shard.insertions;
+    }
+
+    p_target->key = key;
+    p_target->referenced = 0;
+    p_target->block = block;
+    __sync_synchronize();
+    ++shard.version;
+    unlock(shard);
+}
+
+//
+void BlockCache::reject(size_t block_idx)
+{
+    Shard& shard = getShard(hashKey(block_idx + 1));
+    __sync_fetch_and_add(&shard.rejected, 1);
+}
+
+//
+BlockCacheStats BlockCache::getStats() const
+{
+    BlockCacheStats stats;
+    memset(&stats, 0, sizeof(stats));
+    for(size_t i = 0; i < m_numShards; ++i)
+    {
+        Shard& shard = const_cast<Shard&>(m_shards[i]);
+        lock(shard);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.insertions += shard.insertions;
+        stats.evictions += shard.evictions;
+        stats.rejected += shard.rejected;
+        unlock(shard);
+    }
+    return stats;
+}
+
+//
+void BlockCache::resetStats()
+{
+    for(size_t i = 0; i < m_numShards; ++i)
+    {
+        Shard& shard = m_shards[i];
+        lock(shard);
+        shard.hits = 0;
+        shard.misses = 0;
+        shard.insertions = 0;
+        shard.evictions = 0;
+        shard.rejected = 0;
+        unlock(shard);
+    }
+}
+
+//
+void BlockCache::lock(Shard& shard)
+{
+    while(__sync_lock_test_and_set(&shard.lock, 1))
+    {
+        // Wait for the lock to look free before trying to take it again
+        while(shard.lock)
+            sched_yield();
+    }
+}
+
+//
+void BlockCache::unlock(Shard& shard)
+{
+    __sync_lock_release(&shard.lock);
+}
@@ -0,0 +1,198 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// BlockCache - a fixed-size cache of decoded blocks
+// of the huffman-coded bwt, shared by the threads
+// querying an index.
+//
+// Traversals count and extract symbols from the same
+// blocks again and again, at repeats, high-degree
+// vertices and sibling extensions. A cached block holds
+// the counts of every symbol before it and its symbols
+// two bits each, in the layout of TwoBitBWT, so a count
+// is a few popcounts instead of a decode. Blocks that
+// contain a $ are not cached.
+//
+// Block indices are hashed to one of a number of shards.
+// Each shard is an open-addressed table with a short
+// probe window. Insertions take the shard's spinlock
+// and bump its version before and after writing. Lookups
+// do not lock: they copy the entry and retry if the
+// version changed meanwhile, so threads that only read
+// never wait for each other. When the window is full an
+// entry is replaced with the CLOCK policy: a hit marks an
+// entry as referenced, and the hand passes over referenced
+// entries once, clearing the mark, before it replaces one
+// that has not been used since.
+//
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include "alphabet.h"
+
+// The largest block that can be cached
+#define BLOCK_CACHE_MAX_SYMBOLS 256
+
+// The number of 64-bit words holding one bit of each symbol of a block
+#define BLOCK_CACHE_PLANE_WORDS (BLOCK_CACHE_MAX_SYMBOLS / 64)
+
+// The number of slots searched for a block
+#define BLOCK_CACHE_PROBE 8
+
+// A decoded block. The low and high bits of the codes of
+// A, C, G and T are stored interleaved 64 symbols at a time.
+struct DecodedBlock
+{
+    // Set the block from its symbols and the counts before it.
+    // Returns false if a symbol is not A, C, G or T.
+    bool assign(const char* symbols, size_t num_symbols, const AlphaCount64& before);
+
+    // Return the number of times b occurs before symbol r of the block,
+    // including the occurrences before the block
+    inline size_t getCount(char b, size_t r) const
+    {
+        int code = BWT_ALPHABET::getRank(b) - 1;
+        if(code < 0)
+            return counts.get(b);
+        return counts.get(b) + countCode(code, r);
+    }
+
+    // Return the number of times each symbol occurs before symbol r of the block
+    inline AlphaCount64 getFullCount(size_t r) const
+    {
+        AlphaCount64 out = counts;
+        size_t c = countCode(1, r);
+        size_t g = countCode(2, r);
+        size_t t = countCode(3, r);
+        out.add('A', r - c - g - t);
+        out.add('C', c);
+        out.add('G', g);
+        out.add('T', t);
+        return out;
+    }
+
+    // Return symbol r of the block
+    inline char getChar(size_t r) const
+    {
+        return "ACGT"[getCode(r)];
+    }
+
+    // Return the code of symbol r of the block
+    inline int getCode(size_t r) const
+    {
+        const uint64_t* p_planes = planes + 2 * (r >> 6);
+        int shift = r & 63;
+        return ((p_planes[0] >> shift) & 1) | (((p_planes[1] >> shift) & 1) << 1);
+    }
+
+    // Count the symbols with the given code in the first r symbols of the block
+    inline size_t countCode(int code, size_t r) const
+    {
+        uint64_t lo_flip = code & 1 ? 0 : ~0ULL;
+        uint64_t hi_flip = code & 2 ? 0 : ~0ULL;
+
+        size_t count = 0;
+        size_t full_words = r >> 6;
+        for(size_t i = 0; i < full_words; ++i)
+            count += __builtin_popcountll((planes[2 * i] ^ lo_flip) & (planes[2 * i + 1] ^ hi_flip));
+
+        size_t rem = r & 63;
+        if(rem > 0)
+        {
+            uint64_t match = (planes[2 * full_words] ^ lo_flip) & (planes[2 * full_words + 1] ^ hi_flip);
+            count += __builtin_popcountll(match & ((1ULL << rem) - 1));
+        }
+        return count;
+    }
+
+    AlphaCount64 counts;
+    uint64_t planes[2 * BLOCK_CACHE_PLANE_WORDS];
+};
+
+// Counts summed over all shards
+struct BlockCacheStats
+{
+    size_t hits;
+    size_t misses;
+    size_t insertions;
+    size_t evictions;
+
+    // Blocks that could not be cached because they contain a $
+    size_t rejected;
+};
+
+class BlockCache
+{
+    public:
+
+        // Allocate a cache using about num_bytes bytes split over num_shards
+        // shards. The number of entries per shard is rounded up to a power of two.
+        BlockCache(size_t num_bytes, size_t num_shards = 64);
+
+        // Copy the decoded block with the given index into block.
+        // Returns false if it is not cached.
+        bool find(size_t block_idx, DecodedBlock& block);
+
+        // Store a decoded block
+        void insert(size_t block_idx, const DecodedBlock& block);
+
+        // Count a block that could not be decoded into the cache
+        void reject(size_t block_idx);
+
+        // Return the counts summed over the shards
+        BlockCacheStats getStats() const;
+        void resetStats();
+
+        inline size_t getNumEntries() const { return m_numShards * m_shardEntries; }
+        inline size_t getNumBytes() const { return getNumEntries() * sizeof(Entry); }
+
+    private:
+
+        // Keys are the block index plus one, so 0 marks an empty slot
+        struct Entry
+        {
+            uint64_t key;
+            uint64_t referenced;
+            DecodedBlock block;
+        };
+
+        // A shard fills a cache line so the locks and counters
+        // of different shards do not share one. The version
+        // is odd while an entry of the shard is being written.
+        struct Shard
+        {
+            volatile int lock;
+            volatile uint32_t version;
+            size_t hand;
+            size_t hits;
+            size_t misses;
+            size_t insertions;
+            size_t evictions;
+            size_t rejected;
+            Entry* p_entries;
+        };
+
+        // Not copyable
+        BlockCache(const BlockCache&);
+        BlockCache& operator=(const BlockCache&);
+
+        // Return the shard of a hashed key and the first slot of its probe window
+        inline Shard& getShard(uint64_t hash) { return m_shards[hash & (m_numShards - 1)]; }
+        inline size_t getSlot(uint64_t hash) const { return (hash >> 32) & (m_shardEntries - 1); }
+
+        static void lock(Shard& shard);
+        static void unlock(Shard& shard);
+
+        std::vector<Shard> m_shards;
+        std::vector<Entry> m_entries;
+        size_t m_numShards;
+        size_t m_shardEntries;
+};
+
+#endif
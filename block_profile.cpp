@@ -0,0 +1,75 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// BlockProfile - a histogram of block decodes
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <iostream>
+#include "block_profile.h"
+
+//
+void BlockProfile::initialize(size_t num_blocks)
+{
+    m_counts.assign(num_blocks, 0);
+}
+
+//
+uint64_t BlockProfile::getTotal() const
+{
+    uint64_t total = 0;
+    for(size_t i = 0; i < m_counts.size(); ++i)
+        total += m_counts[i];
+    return total;
+}
+
+// The file is a line with the number of blocks, then a line
+// with the index and count of each block that was decoded
+void BlockProfile::save(const std::string& filename) const
+{
+    FILE* p_file = fopen(filename.c_str(), "w");
+    if(p_file == NULL)
+    {
+        std::cerr << "Error: could not write " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(p_file, "%zu\n", m_counts.size());
+    for(size_t i = 0; i < m_counts.size(); ++i)
+    {
+        if(m_counts[i] > 0)
+            fprintf(p_file, "%zu\t%" PRIu64 "\n", i, m_counts[i]);
+    }
+    fclose(p_file);
+}
+
+//
+void BlockProfile::load(const std::string& filename)
+{
+    FILE* p_file = fopen(filename.c_str(), "r");
+    size_t num_blocks = 0;
+    if(p_file == NULL || fscanf(p_file, "%zu", &num_blocks) != 1)
+    {
+        std::cerr << "Error: could not read a block profile from " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    initialize(num_blocks);
+    size_t block_idx;
+    uint64_t count;
+    while(fscanf(p_file, "%zu %" SCNu64, &block_idx, &count) == 2)
+    {
+        if(block_idx >= num_blocks)
+        {
+            std::cerr << "Error: " << filename << " has a count for block " << block_idx
+                      << " but only " << num_blocks << " blocks\n";
+            exit(EXIT_FAILURE);
+        }
+        m_counts[block_idx] += count;
+    }
+    fclose(p_file);
+}
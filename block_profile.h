@@ -0,0 +1,48 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// BlockProfile - a histogram of how often each block
+// of the huffman-coded bwt is decoded, collected while
+// an index answers a representative workload. It is
+// used to choose the blocks that get extra checkpoints.
+//
+#ifndef BLOCK_PROFILE_H
+#define BLOCK_PROFILE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+class BlockProfile
+{
+    public:
+        BlockProfile() {}
+
+        // Count decodes of num_blocks blocks, starting from zero
+        void initialize(size_t num_blocks);
+
+        // Count one decode of a block. Threads may record at the same time.
+        inline void record(size_t block_idx)
+        {
+            __sync_fetch_and_add(&m_counts[block_idx], 1);
+        }
+
+        inline size_t size() const { return m_counts.size(); }
+        inline uint64_t getCount(size_t block_idx) const { return m_counts[block_idx]; }
+
+        // Return the total number of decodes recorded
+        uint64_t getTotal() const;
+
+        // Write the profile to a file, or read a profile written by save()
+        void save(const std::string& filename) const;
+        void load(const std::string& filename);
+
+    private:
+        std::vector<uint64_t> m_counts;
+};
+
+#endif
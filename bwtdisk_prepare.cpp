@@ -13,16 +13,35 @@
 #include <string>
 #include <stdlib.h>
 
-int main(int argc, char** argv)
+// Write the reverse-complement of a record
+static void writeReverseComplement(const std::string& record)
 {
+    std::string rc(record.rbegin(), record.rend());
+    for(size_t i = 0; i < rc.size(); ++i)
+    {
+        switch(rc[i])
+        {
+            case 'A': rc[i] = 'T'; break;
+            case 'C': rc[i] = 'G'; break;
+            case 'G': rc[i] = 'C'; break;
+            case 'T': rc[i] = 'A'; break;
+        }
+    }
+    std::cout << rc;
+}
 
-    if(argc != 2) {
+int main(int argc, char** argv)
+{
+    // With --rc each record is followed by its reverse-complement, so the
+    // index built from the output contains both strands of every record
+    bool write_rc = argc == 3 && std::string(argv[1]) == "--rc";
+    if(argc != 2 && !write_rc) {
         fprintf(stderr, "Error: a filename must be provided\n");
-        fprintf(stderr, "usage: bwtdisk-prepare filename > output\n");
+        fprintf(stderr, "usage: bwtdisk-prepare [--rc] filename > output\n");
         exit(EXIT_FAILURE);
     }
     
-    std::string filename = argv[1];
+    std::string filename = argv[argc - 1];
 
     std::string line;
     std::ifstream reader(filename.c_str());
@@ -34,15 +53,23 @@ int main(int argc, char** argv)
     // Read the fasta file line by line.
     // When we hit a header we output a symbol separating the current record
     // from the last. Non-ACGT symbols in the records cause an error.
+    // The current record is only kept when its reverse-complement is needed.
     size_t n_records = 0;
+    std::string record;
     while(getline(reader, line)) {
         if(line.empty())
             continue;
         
         if(line[0] == '>') {
 
-            if(n_records++ > 0)
+            if(n_records++ > 0) {
                 std::cout << '$';
+                if(write_rc) {
+                    writeReverseComplement(record);
+                    std::cout << '$';
+                    record.clear();
+                }
+            }
         } else {
             if(line.find_first_not_of("ACGT") != std::string::npos) {
                 fprintf(stderr, "Error: non-ACGT base found.\n");
@@ -50,9 +77,15 @@ int main(int argc, char** argv)
             }
                
             std::cout << line;
+            if(write_rc)
+                record.append(line);
         }
     }
 
     // Print a final sentinel for the last string
     std::cout << '$';
+    if(write_rc) {
+        writeReverseComplement(record);
+        std::cout << '$';
+    }
 }
@@ -13,51 +13,331 @@
 //
 bool DBGQuery::isVertex(const FMIndex* index, const std::string& s)
 {
-    return index->count(s) > 0 || index->count(reverseComplement(s)) > 0;
+    return VertexHandle(index, s).isVertex();
 }
 
 //
 bool DBGQuery::isSuffixNeighbor(const FMIndex* index, const std::string& s, char b)
 {
-    // Make the neighbor string
-    std::string t = s.substr(1) + b;
-    return isVertex(index, t);
+    return VertexHandle(index, s).isSuffixNeighbor(b);
 }
 
 //
 bool DBGQuery::isPrefixNeighbor(const FMIndex* index, const std::string& s, char b)
 {
-    // Make the neighbor string
-    std::string t = b + s.substr(0, s.size() - 1);
-    return isVertex(index, t);
+    return VertexHandle(index, s).isPrefixNeighbor(b);
 }
 
 //
 std::string DBGQuery::getSuffixNeighbors(const FMIndex* index, const std::string& s)
 {
+    return VertexHandle(index, s).getSuffixNeighbors();
+}
+
+//
+std::string DBGQuery::getPrefixNeighbors(const FMIndex* index, const std::string& s)
+{
+    return VertexHandle(index, s).getPrefixNeighbors();
+}
+
+// Return the number of times each symbol precedes an occurrence of a packed core.
+// The empty core of a 1-mer is in every suffix.
+template<typename Word>
+static AlphaCount64 getPackedLeftExtensions(const FMIndex* index, const BasicPackedKmer<Word>& core)
+{
+    std::pair<size_t, size_t> interval(0, index->getBWLen() - 1);
+    if(!core.empty())
+        interval = index->findInterval(core);
+    if(interval.first > interval.second)
+        return AlphaCount64();
+    return index->getOccDiff(interval.first - 1, interval.second);
+}
+
+// The k-mer filter holds k-mers of up to 32 bases
+static inline bool mayBeVertex(const FMIndex* index, const PackedKmer& s)
+{
+    return index->getKmerFilter().mayContain(s);
+}
+
+static inline bool mayBeVertex(const FMIndex*, const LongPackedKmer&)
+{
+    return true;
+}
+
+//
+template<typename Word>
+bool DBGQuery::isVertex(const FMIndex* index, const BasicPackedKmer<Word>& s)
+{
+    if(!mayBeVertex(index, s))
+        return false;
+    if(index->count(s) > 0)
+        return true;
+    return !index->isStrandSymmetric() && index->count(s.reverseComplement()) > 0;
+}
+
+//
+template<typename Word>
+bool DBGQuery::isSuffixNeighbor(const FMIndex* index, const BasicPackedKmer<Word>& s, char b)
+{
+    BasicPackedKmer<Word> next = s;
+    next.shiftInLast(b);
+    return isVertex(index, next);
+}
+
+//
+template<typename Word>
+bool DBGQuery::isPrefixNeighbor(const FMIndex* index, const BasicPackedKmer<Word>& s, char b)
+{
+    BasicPackedKmer<Word> next = s;
+    next.shiftInFirst(b);
+    return isVertex(index, next);
+}
+
+//
+template<typename Word>
+std::string DBGQuery::getSuffixNeighbors(const FMIndex* index, const BasicPackedKmer<Word>& s)
+{
+    // As in VertexHandle, the neighbors b'X' on the other strand are the left
+    // extensions of X' and the neighbors Xb on this strand are searched
+    AlphaCount64 rc_extensions = getPackedLeftExtensions(index, s.dropFirst().reverseComplement());
+    bool symmetric = index->isStrandSymmetric();
     std::string out;
     for(size_t i = 0; i < 4; ++i)
     {
         char b = "ACGT"[i];
-        if(isSuffixNeighbor(index, s, b))
+        if(rc_extensions.get(complement(b)) > 0)
+        {
             out.append(1, b);
+        }
+        else if(!symmetric)
+        {
+            BasicPackedKmer<Word> next = s;
+            next.shiftInLast(b);
+            if(index->count(next) > 0)
+                out.append(1, b);
+        }
     }
     return out;
 }
 
 //
-std::string DBGQuery::getPrefixNeighbors(const FMIndex* index, const std::string& s)
+template<typename Word>
+std::string DBGQuery::getPrefixNeighbors(const FMIndex* index, const BasicPackedKmer<Word>& s)
 {
+    // The neighbors bY on this strand are the left extensions of Y
+    // and the neighbors Y'b' on the other strand are searched
+    AlphaCount64 extensions = getPackedLeftExtensions(index, s.dropLast());
+    bool symmetric = index->isStrandSymmetric();
     std::string out;
     for(size_t i = 0; i < 4; ++i)
     {
         char b = "ACGT"[i];
-        if(isPrefixNeighbor(index, s, b))
+        if(extensions.get(b) > 0)
+        {
             out.append(1, b);
+        }
+        else if(!symmetric)
+        {
+            BasicPackedKmer<Word> next = s;
+            next.shiftInFirst(b);
+            if(index->count(next.reverseComplement()) > 0)
+                out.append(1, b);
+        }
     }
     return out;
 }
 
+// Instantiate the packed queries for both k-mer sizes
+#define INSTANTIATE_PACKED_QUERIES(Word) \
+    template bool DBGQuery::isVertex(const FMIndex*, const BasicPackedKmer<Word>&); \
+    template bool DBGQuery::isSuffixNeighbor(const FMIndex*, const BasicPackedKmer<Word>&, char); \
+    template bool DBGQuery::isPrefixNeighbor(const FMIndex*, const BasicPackedKmer<Word>&, char); \
+    template std::string DBGQuery::getSuffixNeighbors(const FMIndex*, const BasicPackedKmer<Word>&); \
+    template std::string DBGQuery::getPrefixNeighbors(const FMIndex*, const BasicPackedKmer<Word>&);
+
+INSTANTIATE_PACKED_QUERIES(uint64_t)
+INSTANTIATE_PACKED_QUERIES(unsigned __int128)
+
+// Find the interval of every string with findIntervals. The empty
+// string, the core of a 1-mer, is in every suffix.
+static void findCoreIntervals(const FMIndex* index, const std::vector<std::string>& cores,
+                              std::vector<std::pair<size_t, size_t> >& intervals, size_t batch_size)
+{
+    std::vector<std::string> patterns;
+    std::vector<size_t> pattern_idx;
+    for(size_t i = 0; i < cores.size(); ++i)
+    {
+        if(!cores[i].empty())
+        {
+            patterns.push_back(cores[i]);
+            pattern_idx.push_back(i);
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t> > found;
+    index->findIntervals(patterns, found, batch_size);
+    intervals.assign(cores.size(), std::make_pair(0, index->getBWLen() - 1));
+    for(size_t i = 0; i < found.size(); ++i)
+        intervals[pattern_idx[i]] = found[i];
+}
+
+// Set bit b of mask[i] for every base b that precedes an occurrence of cores[i]
+static void getLeftExtensionMasks(const FMIndex* index, const std::vector<std::string>& cores,
+                                  std::vector<int>& masks, size_t batch_size)
+{
+    std::vector<std::pair<size_t, size_t> > intervals;
+    findCoreIntervals(index, cores, intervals, batch_size);
+    masks.assign(cores.size(), 0);
+    for(size_t i = 0; i < cores.size(); ++i)
+    {
+        if(intervals[i].first > intervals[i].second)
+            continue;
+        AlphaCount64 extensions = index->getOccDiff(intervals[i].first - 1, intervals[i].second);
+        for(size_t j = 0; j < 4; ++j)
+            masks[i] |= extensions.get("ACGT"[j]) > 0 ? 1 << j : 0;
+    }
+}
+
+// Add the neighbors on the other strand to the masks. Base j of k-mer i is
+// a neighbor if stems[i] followed by base j, or its complement when 
+// complement_base is set, occurs. Bases that are already set are not searched.
+static void addSearchedNeighbors(const FMIndex* index, const std::vector<std::string>& stems, bool complement_base,
+                                 std::vector<int>& masks, size_t batch_size)
+{
+    std::vector<std::string> patterns;
+    std::vector<size_t> pattern_idx;
+    for(size_t i = 0; i < stems.size(); ++i)
+    {
+        for(size_t j = 0; j < 4; ++j)
+        {
+            if(masks[i] & (1 << j))
+                continue;
+            char b = "ACGT"[j];
+            patterns.push_back(stems[i] + (complement_base ? complement(b) : b));
+            pattern_idx.push_back(4 * i + j);
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t> > intervals;
+    index->findIntervals(patterns, intervals, batch_size);
+    for(size_t i = 0; i < intervals.size(); ++i)
+    {
+        if(intervals[i].first <= intervals[i].second)
+            masks[pattern_idx[i] / 4] |= 1 << (pattern_idx[i] % 4);
+    }
+}
+
+// Convert neighbor masks to strings of bases
+static void masksToNeighbors(const std::vector<int>& masks, std::vector<std::string>& out)
+{
+    out.assign(masks.size(), std::string());
+    for(size_t i = 0; i < masks.size(); ++i)
+    {
+        for(size_t j = 0; j < 4; ++j)
+        {
+            if(masks[i] & (1 << j))
+                out[i].append(1, "ACGT"[j]);
+        }
+    }
+}
+
+//
+void DBGQuery::isVertexBatch(const FMIndex* index, const std::vector<std::string>& kmers,
+                             std::vector<bool>& out, size_t batch_size)
+{
+    out.assign(kmers.size(), false);
+
+    // The k-mers rejected by the index's k-mer filter are not searched
+    const KmerFilter& filter = index->getKmerFilter();
+    std::vector<std::string> filtered_kmers;
+    std::vector<size_t> filtered_idx;
+    const std::vector<std::string>* p_kmers = &kmers;
+    if(filter.getK() > 0)
+    {
+        for(size_t i = 0; i < kmers.size(); ++i)
+        {
+            if(filter.mayContain(kmers[i]))
+            {
+                filtered_kmers.push_back(kmers[i]);
+                filtered_idx.push_back(i);
+            }
+        }
+        p_kmers = &filtered_kmers;
+    }
+
+    std::vector<std::pair<size_t, size_t> > intervals;
+    index->findIntervals(*p_kmers, intervals, batch_size);
+
+    // Only the k-mers that were not found are searched on the other strand
+    std::vector<std::string> rc_kmers;
+    std::vector<size_t> rc_idx;
+    for(size_t i = 0; i < p_kmers->size(); ++i)
+    {
+        size_t j = p_kmers == &kmers ? i : filtered_idx[i];
+        out[j] = intervals[i].first <= intervals[i].second;
+        if(!out[j] && !index->isStrandSymmetric())
+        {
+            rc_kmers.push_back(reverseComplement(kmers[j]));
+            rc_idx.push_back(j);
+        }
+    }
+
+    index->findIntervals(rc_kmers, intervals, batch_size);
+    for(size_t i = 0; i < rc_kmers.size(); ++i)
+        out[rc_idx[i]] = intervals[i].first <= intervals[i].second;
+}
+
+//
+void DBGQuery::getSuffixNeighborsBatch(const FMIndex* index, const std::vector<std::string>& kmers,
+                                       std::vector<std::string>& out, size_t batch_size)
+{
+    // The neighbors b'X' on the other strand extend X' to the left.
+    // The masks are complemented below, which reverses the bit order.
+    std::vector<std::string> cores(kmers.size());
+    for(size_t i = 0; i < kmers.size(); ++i)
+        cores[i] = reverseComplement(kmers[i].substr(1));
+
+    std::vector<int> masks;
+    getLeftExtensionMasks(index, cores, masks, batch_size);
+    for(size_t i = 0; i < masks.size(); ++i)
+    {
+        int m = masks[i];
+        masks[i] = ((m & 1) << 3) | ((m & 2) << 1) | ((m & 4) >> 1) | ((m & 8) >> 3);
+    }
+
+    // The neighbors Xb on this strand are searched unless both strands are indexed
+    if(!index->isStrandSymmetric())
+    {
+        std::vector<std::string> stems(kmers.size());
+        for(size_t i = 0; i < kmers.size(); ++i)
+            stems[i] = kmers[i].substr(1);
+        addSearchedNeighbors(index, stems, false, masks, batch_size);
+    }
+    masksToNeighbors(masks, out);
+}
+
+//
+void DBGQuery::getPrefixNeighborsBatch(const FMIndex* index, const std::vector<std::string>& kmers,
+                                       std::vector<std::string>& out, size_t batch_size)
+{
+    // The neighbors bY on this strand extend Y to the left
+    std::vector<std::string> cores(kmers.size());
+    for(size_t i = 0; i < kmers.size(); ++i)
+        cores[i] = kmers[i].substr(0, kmers[i].size() - 1);
+
+    std::vector<int> masks;
+    getLeftExtensionMasks(index, cores, masks, batch_size);
+
+    // The neighbors Y'b' on the other strand are searched unless both strands are indexed
+    if(!index->isStrandSymmetric())
+    {
+        for(size_t i = 0; i < kmers.size(); ++i)
+            cores[i] = reverseComplement(cores[i]);
+        addSearchedNeighbors(index, cores, true, masks, batch_size);
+    }
+    masksToNeighbors(masks, out);
+}
+
 //
 std::pair<std::string, size_t>
 DBGQuery::extractSubstringAndIndex(
@@ -66,14 +346,16 @@ DBGQuery::extractSubstringAndIndex(
     std::string out;
     out.reserve(len);
 
+    // Each step reads the symbol and moves to the previous row with one decode
     while(out.length() < len)
     {
-        char b = index->getChar(idx);
+        char b;
+        size_t next = index->LFWithChar(idx, b);
         if(b == EOF)
             break;
 
         out.push_back(b);
-        idx = index->LF(idx);
+        idx = next;
     }
 
     std::reverse(out.begin(), out.end());
@@ -5,19 +5,26 @@
 //-----------------------------------------------
 //
 // DBGQuery - API for querying properties of a
-// de Bruijn graph encoded as an FM-index
+// de Bruijn graph encoded as an FM-index.
+// Traversals that move from vertex to vertex
+// should use VertexHandle, which these functions
+// are built on, to reuse the intervals found
+// at each step.
 //
 #ifndef DBG_QUERY_H
 #define DBG_QUERY_H
 
 #include "fm_index.h"
+#include "vertex_handle.h"
 #include <string>
+#include <vector>
 #include <utility>
 
 namespace DBGQuery
 {
     // Returns true if the k-mer string s is a vertex in the
-    // de Bruijn graph represented by the provided FM-index
+    // de Bruijn graph represented by the provided FM-index.
+    // A strand-symmetric index answers with a single search.
     bool isVertex(const FMIndex* index, const std::string& s);
 
     // Check for a particular neighbor of k-mer s in the de Bruijn graph.
@@ -43,6 +50,35 @@ namespace DBGQuery
     std::string getSuffixNeighbors(const FMIndex* index, const std::string& s);
     std::string getPrefixNeighbors(const FMIndex* index, const std::string& s);
 
+    // Versions of the queries above for k-mers packed in a PackedKmer or
+    // LongPackedKmer. The neighbor k-mers are formed by shifting bits, and
+    // the neighbor sets fit in the string's own buffer, so no heap memory
+    // is allocated. The index's IntervalCache is not used.
+    template<typename Word>
+    bool isVertex(const FMIndex* index, const BasicPackedKmer<Word>& s);
+
+    template<typename Word>
+    bool isSuffixNeighbor(const FMIndex* index, const BasicPackedKmer<Word>& s, char b);
+
+    template<typename Word>
+    bool isPrefixNeighbor(const FMIndex* index, const BasicPackedKmer<Word>& s, char b);
+
+    template<typename Word>
+    std::string getSuffixNeighbors(const FMIndex* index, const BasicPackedKmer<Word>& s);
+
+    template<typename Word>
+    std::string getPrefixNeighbors(const FMIndex* index, const BasicPackedKmer<Word>& s);
+
+    // Batched versions of isVertex and getSuffixNeighbors/getPrefixNeighbors.
+    // The searches for all k-mers are interleaved with FMIndex::findIntervals,
+    // which is faster than querying one k-mer at a time when there are many.
+    void isVertexBatch(const FMIndex* index, const std::vector<std::string>& kmers, 
+                       std::vector<bool>& out, size_t batch_size = FMIndex::DEFAULT_BATCH_SIZE);
+    void getSuffixNeighborsBatch(const FMIndex* index, const std::vector<std::string>& kmers, 
+                                 std::vector<std::string>& out, size_t batch_size = FMIndex::DEFAULT_BATCH_SIZE);
+    void getPrefixNeighborsBatch(const FMIndex* index, const std::vector<std::string>& kmers, 
+                                 std::vector<std::string>& out, size_t batch_size = FMIndex::DEFAULT_BATCH_SIZE);
+
     // Extract a substring of the original text by decompressing a portion
     // of the FM-index. Also return the suffix array index of the
     // substring.
@@ -0,0 +1,84 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// densify_main - the dbgfm densify subcommand
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include "densify_main.h"
+#include "fm_index.h"
+#include "fm_index_file.h"
+#include "block_profile.h"
+
+static const char* DENSIFY_USAGE =
+"usage: dbgfm densify [-m max_kb] <index.dbgfm> <profile> <out.dbgfm>\n"
+"\n"
+"Add checkpoints to the blocks of a huffman-coded index that were decoded\n"
+"most often in profile, as written by dbgfm query -p, and write the index\n"
+"to out.dbgfm. A decode within a block with a checkpoint reads at most a\n"
+"quarter of the block instead of half. Checkpoints already in the index\n"
+"are replaced.\n"
+"\n"
+"  -m max_kb      memory for the checkpoints in kilobytes (default 1024)\n";
+
+//
+int densifyMain(int argc, char** argv)
+{
+    size_t max_kb = 1024;
+
+    int c;
+    while((c = getopt(argc, argv, "m:h")) != -1)
+    {
+        switch(c)
+        {
+            case 'm': max_kb = strtoul(optarg, NULL, 10); break;
+            case 'h': printf("%s", DENSIFY_USAGE); return EXIT_SUCCESS;
+            default: fprintf(stderr, "%s", DENSIFY_USAGE); return EXIT_FAILURE;
+        }
+    }
+
+    if(argc - optind != 3)
+    {
+        fprintf(stderr, "%s", DENSIFY_USAGE);
+        return EXIT_FAILURE;
+    }
+
+    std::string index_filename = argv[optind];
+    std::string profile_filename = argv[optind + 1];
+    std::string out_filename = argv[optind + 2];
+    if(!FMIndexFileReader::isIndexFile(index_filename))
+    {
+        fprintf(stderr, "Error: %s is not an index file\n", index_filename.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // The input is mapped while the output is written
+    if(out_filename == index_filename)
+    {
+        fprintf(stderr, "Error: the output must be written to a new file\n");
+        return EXIT_FAILURE;
+    }
+
+    BlockProfile profile;
+    profile.load(profile_filename);
+
+    FMIndexParameters params;
+    params.verbose = false;
+    FMIndex index(index_filename, params);
+    size_t num_added = index.addCheckpoints(profile, max_kb << 10);
+    index.save(out_filename);
+
+    // Report the share of the recorded decodes that now start from a checkpoint
+    uint64_t covered = 0;
+    for(size_t i = 0; i < profile.size(); ++i)
+        covered += index.hasCheckpoint(i) ? profile.getCount(i) : 0;
+    uint64_t total = profile.getTotal();
+    fprintf(stderr, "Added checkpoints to %zu of %zu blocks, covering %.1lf%% of %zu recorded decodes\n",
+            num_added, index.getNumBlocks(), total > 0 ? 100.0 * covered / total : 0.0, (size_t)total);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,18 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// densify_main - the dbgfm densify subcommand, which
+// adds checkpoints to the blocks of an index that a
+// recorded workload decoded most often and writes
+// the index to a new file.
+//
+#ifndef DENSIFY_MAIN_H
+#define DENSIFY_MAIN_H
+
+// Run the subcommand. argv[0] is "densify".
+int densifyMain(int argc, char** argv);
+
+#endif
@@ -8,6 +8,8 @@
 //
 #include <istream>
 #include <queue>
+#include <algorithm>
+#include <functional>
 #include <inttypes.h>
 #include <stdio.h>
 #include "fm_index.h"
@@ -15,46 +17,190 @@
 #include "sga_bwt_reader.h"
 #include "huffman_tree_codec.h"
 #include "fm_index_builder.h"
+#include "fm_index_file.h"
+
+// The scalar members of the index, stored in the FMS_INFO section of an index file
+struct FMIndexFileInfo
+{
+    uint64_t num_strings;
+    uint64_t num_symbols;
+    uint64_t eof_pos;
+    uint64_t large_sample_rate;
+    uint64_t small_sample_rate;
+    uint64_t symbol_counts[BWT_ALPHABET::size];
+    int64_t decoder_read_length;
+    uint64_t backend;
+    uint64_t strand_symmetric;
+};
 
 // Parse a BWT from a file
-FMIndex::FMIndex(const std::string& filename, int sampleRate) : m_numStrings(0), 
-                                                                m_numSymbols(0)
+FMIndex::FMIndex(const std::string& filename, 
+                 int sampleRate,
+                 const std::string& outFilename) : m_numStrings(0), 
+                                                   m_numSymbols(0),
+                                                   mp_indexFile(NULL),
+                                                   mp_intervalCache(NULL),
+                                                   mp_blockCache(NULL),
+                                                   mp_blockProfile(NULL),
+                                                   m_strandSymmetric(false)
 {
-    setSampleRates(DEFAULT_SAMPLE_RATE_LARGE, sampleRate);
+    FMIndexParameters params;
+    params.smallSampleRate = sampleRate;
+    params.outFilename = outFilename;
+    load(filename, params);
+}
 
-    std::cout << "Loading " << filename << "\n";
-    loadBWT(filename);
+//
+FMIndex::FMIndex(const std::string& filename, const FMIndexParameters& params) : m_numStrings(0),
+                                                                                 m_numSymbols(0),
+                                                                                 mp_indexFile(NULL),
+                                                                                 mp_intervalCache(NULL),
+                                                                                 mp_blockCache(NULL),
+                                                                                 mp_blockProfile(NULL),
+                                                                                 m_strandSymmetric(false)
+{
+    load(filename, params);
+}
+
+//
+void FMIndex::load(const std::string& filename, const FMIndexParameters& params)
+{
+    if(params.verbose)
+        std::cout << "Loading " << filename << "\n";
+    if(FMIndexFileReader::isIndexFile(filename))
+    {
+        loadIndexFile(filename);
+    }
+    else
+    {
+        setSampleRates(params.largeSampleRate, params.smallSampleRate);
+        m_backend = params.backend;
+        loadBWT(filename);
+
+        // Both strands of the text have the same base composition,
+        // which catches a bwt that was built without --rc
+        if(params.strandSymmetric)
+        {
+            AlphaCount64 totals = getFullOcc(m_numSymbols - 1);
+            if(totals.get('A') != totals.get('T') || totals.get('C') != totals.get('G'))
+            {
+                std::cerr << "Error: " << filename << " does not contain the reverse complement of every record\n";
+                exit(EXIT_FAILURE);
+            }
+            m_strandSymmetric = true;
+        }
+
+        if(params.intervalTableQ > 0)
+            buildIntervalTable(params.intervalTableQ);
+        if(params.kmerFilterK > 0)
+            buildKmerFilter(params.kmerFilterK, params.kmerFilterBitsPerKmer);
+
+        if(!params.outFilename.empty())
+            save(params.outFilename);
+    }
+
+    if(params.verbose)
+        printInfo();
+}
+
+//
+FMIndex::~FMIndex()
+{
+    delete mp_indexFile;
 }
 
 //
 void FMIndex::loadBWT(const std::string& filename)
 {
+    // The uncompressed backends read the bwt directly
+    if(!isHuffmanBackend())
+    {
+        AlphaCount64 totals;
+        switch(m_backend)
+        {
+            case FMI_BACKEND_TWO_BIT:
+                m_twoBit.build(filename);
+                totals = m_twoBit.getSymbolCounts();
+                m_eof_pos = m_twoBit.getEOFPos();
+                break;
+            case FMI_BACKEND_RUN_LENGTH:
+                m_runLength.build(filename);
+                totals = m_runLength.getSymbolCounts();
+                m_eof_pos = m_runLength.getEOFPos();
+                break;
+            default:
+                m_waveletMatrix.build(filename);
+                totals = m_waveletMatrix.getSymbolCounts();
+                m_eof_pos = m_waveletMatrix.getEOFPos();
+                break;
+        }
+
+        m_numSymbols = totals.getSum();
+        m_numStrings = totals.get('$') - 1;
+        initializePredCount(totals);
+        initializeEncodedData();
+        return;
+    }
+
     FMIndexBuilder builder(filename, m_smallSampleRate, m_largeSampleRate);
 
-    size_t n = 0;
+    // Take the compressed string and markers from the builder without copying them
+    std::vector<uint8_t> string_buffer;
+    builder.swapString(string_buffer);
+    m_string.swap(string_buffer);
 
-    // Load the compressed string from the file
-    std::ifstream str_reader(builder.getStringFilename().c_str());
-    n = builder.getNumStringBytes();
-    m_string.resize(n);
-    str_reader.read(reinterpret_cast<char*>(&m_string[0]), n);
-
-    // Load the small markers from the file
-    std::ifstream sm_reader(builder.getSmallMarkerFilename().c_str());
-    n = builder.getNumSmallMarkers();
-    m_smallMarkers.resize(n);
-    sm_reader.read(reinterpret_cast<char*>(&m_smallMarkers[0]), sizeof(SmallMarker) * n);
-    
-    // Load the large markers from the file
-    std::ifstream lm_reader(builder.getLargeMarkerFilename().c_str());
-    n = builder.getNumLargeMarkers();
-    m_largeMarkers.resize(n);
-    lm_reader.read(reinterpret_cast<char*>(&m_largeMarkers[0]), sizeof(LargeMarker) * n);
+    builder.swapSmallMarkers(m_smallMarkers);
+    builder.swapLargeMarkers(m_largeMarkers);
+    builder.swapReverseBytes(m_reverseBytes);
+
+    std::vector<uint8_t> symbols_buffer;
+    builder.swapHalfBlockSymbols(symbols_buffer);
+    m_halfBlockSymbols.swap(symbols_buffer);
 
     m_numStrings = builder.getNumStrings();
     m_numSymbols = builder.getNumSymbols();
+    initializePredCount(builder.getSymbolCounts());
+
+    m_decoder = builder.getDecoder();
+    m_eof_pos = builder.getEOFPos();
 
-    AlphaCount64 totals = builder.getSymbolCounts();
+    // Interleave the markers with the encoded string and release the original arrays
+    if(m_backend == FMI_BACKEND_HUFFMAN_SUPERBLOCK)
+    {
+        m_superblocks.build(m_string.ptr(), builder.getNumStringBytes(), m_smallMarkers, m_largeMarkers, 
+                            m_reverseBytes, m_smallSampleRate, m_largeSampleRate);
+        m_string = FMBytes();
+        m_smallMarkers = PackedMarkerVector();
+        m_largeMarkers = PackedMarkerVector();
+        m_reverseBytes = PackedMarkerVector();
+    }
+
+    initializeEncodedData();
+}
+
+//
+void FMIndex::initializeEncodedData()
+{
+    if(m_backend == FMI_BACKEND_HUFFMAN_SUPERBLOCK)
+    {
+        mp_encoded = m_superblocks.getData();
+        mp_encodedEnd = mp_encoded + m_superblocks.getNumBytes() - 1;
+    }
+    else if(!isHuffmanBackend())
+    {
+        mp_encoded = NULL;
+        mp_encodedEnd = NULL;
+    }
+    else
+    {
+        mp_encoded = m_string.ptr();
+        mp_encodedEnd = &m_string.back();
+    }
+}
+
+//
+void FMIndex::initializePredCount(const AlphaCount64& totals)
+{
     assert(totals.get('$') + 
            totals.get('A') + 
            totals.get('C') + 
@@ -68,11 +214,323 @@ void FMIndex::loadBWT(const std::string& filename)
     m_predCount.set('G', m_predCount.get('C') + totals.get('C'));
     m_predCount.set('T', m_predCount.get('G') + totals.get('G'));
     assert(m_predCount.get('T') + totals.get('T') == m_numSymbols);
+}
 
-    m_decoder = builder.getDecoder();
-    m_eof_pos = builder.getEOFPos();
+//
+void FMIndex::loadIndexFile(const std::string& filename)
+{
+    mp_indexFile = new FMIndexFileReader(filename);
 
-    printInfo();
+    size_t n = 0;
+    const FMIndexFileInfo* p_info = mp_indexFile->getArray<FMIndexFileInfo>(FMS_INFO, n);
+    assert(n == 1);
+
+    m_numStrings = p_info->num_strings;
+    m_numSymbols = p_info->num_symbols;
+    m_eof_pos = p_info->eof_pos;
+    setSampleRates(p_info->large_sample_rate, p_info->small_sample_rate);
+
+    AlphaCount64 totals;
+    for(size_t i = 0; i < BWT_ALPHABET::size; ++i)
+        totals.setByIdx(i, p_info->symbol_counts[i]);
+    initializePredCount(totals);
+
+    if(p_info->backend > FMI_BACKEND_WAVELET_MATRIX)
+    {
+        std::cerr << "Error: " << filename << " uses an unknown backend (" << p_info->backend << ")\n";
+        exit(EXIT_FAILURE);
+    }
+    m_backend = static_cast<FMIndexBackend>(p_info->backend);
+    m_strandSymmetric = p_info->strand_symmetric != 0;
+
+    if(isHuffmanBackend())
+    {
+        const PACKED_DECODE_TYPE* p_table = mp_indexFile->getArray<PACKED_DECODE_TYPE>(FMS_DECODER, n);
+        m_decoder.initialize(p_table, n, p_info->decoder_read_length);
+    }
+
+    // The remaining data is used directly from the mapping
+    if(m_backend == FMI_BACKEND_TWO_BIT)
+    {
+        const TwoBitBWTInfo* p_two_bit = mp_indexFile->getArray<TwoBitBWTInfo>(FMS_TWO_BIT_INFO, n);
+        assert(n == 1);
+        const uint64_t* p_blocks = mp_indexFile->getArray<uint64_t>(FMS_TWO_BIT_BLOCKS, n);
+        assert(n == p_two_bit->num_blocks * TWO_BIT_BLOCK_WORDS);
+        const uint64_t* p_dollars = mp_indexFile->getArray<uint64_t>(FMS_TWO_BIT_DOLLARS, n);
+        assert(n == p_two_bit->num_dollars);
+        m_twoBit.map(*p_two_bit, p_blocks, p_dollars);
+    }
+    else if(m_backend == FMI_BACKEND_RUN_LENGTH)
+    {
+        const RunLengthBWTInfo* p_rl = mp_indexFile->getArray<RunLengthBWTInfo>(FMS_RUN_LENGTH_INFO, n);
+        assert(n == 1);
+        const RLUnit* p_units = mp_indexFile->getArray<RLUnit>(FMS_RUN_LENGTH_UNITS, n);
+        assert(n == p_rl->num_units);
+        const uint64_t* p_positions = mp_indexFile->getArray<uint64_t>(FMS_RUN_LENGTH_POSITIONS, n);
+        assert(n == p_rl->num_markers);
+        const uint32_t* p_lookup = mp_indexFile->getArray<uint32_t>(FMS_RUN_LENGTH_LOOKUP, n);
+        assert(n == p_rl->num_lookup);
+        const PackedMarkerInfo* p_marker_info = mp_indexFile->getArray<PackedMarkerInfo>(FMS_RUN_LENGTH_MARKER_INFO, n);
+        assert(n == 1);
+        const uint64_t* p_markers = mp_indexFile->getArray<uint64_t>(FMS_RUN_LENGTH_MARKERS, n);
+        m_runLength.map(*p_rl, p_units, p_positions, p_lookup, *p_marker_info, p_markers);
+    }
+    else if(m_backend == FMI_BACKEND_WAVELET_MATRIX)
+    {
+        const WaveletMatrixInfo* p_wm = mp_indexFile->getArray<WaveletMatrixInfo>(FMS_WAVELET_INFO, n);
+        assert(n == 1);
+        const uint64_t* p_levels[WM_LEVELS];
+        for(size_t l = 0; l < WM_LEVELS; ++l)
+        {
+            p_levels[l] = mp_indexFile->getArray<uint64_t>(FMS_WAVELET_LEVEL_0 + l, n);
+            assert(n == RankBitVector::getNumWords(p_wm->num_symbols));
+        }
+        m_waveletMatrix.map(*p_wm, p_levels);
+    }
+    else if(m_backend == FMI_BACKEND_HUFFMAN_SUPERBLOCK)
+    {
+        const SuperblockLayoutInfo* p_layout = mp_indexFile->getArray<SuperblockLayoutInfo>(FMS_SUPERBLOCK_INFO, n);
+        assert(n == 1);
+        const uint8_t* p_data = mp_indexFile->getArray<uint8_t>(FMS_SUPERBLOCKS, n);
+        assert(n == p_layout->num_bytes);
+        m_superblocks.map(*p_layout, p_data);
+    }
+    else
+    {
+        const uint8_t* p_string = mp_indexFile->getArray<uint8_t>(FMS_STRING, n);
+        m_string.map(p_string, n);
+
+        mapMarkers(FMS_SMALL_MARKER_INFO, FMS_SMALL_MARKERS, m_smallMarkers);
+        mapMarkers(FMS_LARGE_MARKER_INFO, FMS_LARGE_MARKERS, m_largeMarkers);
+        mapMarkers(FMS_REVERSE_BYTES_INFO, FMS_REVERSE_BYTES, m_reverseBytes);
+    }
+
+    // Files written before the block summaries were added do not have them,
+    // in which case every count is decoded
+    const void* p_symbols = mp_indexFile->getSection(FMS_HALF_BLOCK_SYMBOLS, n);
+    if(p_symbols != NULL)
+    {
+        assert(n == 2 * ((m_numSymbols >> m_smallShiftValue) + 1));
+        m_halfBlockSymbols.map(static_cast<const uint8_t*>(p_symbols), n);
+    }
+
+    // Checkpoints are only present if they were added with a profile
+    const void* p_checkpoint_blocks = mp_indexFile->getSection(FMS_CHECKPOINT_BLOCKS, n);
+    if(p_checkpoint_blocks != NULL)
+    {
+        assert(n == RankBitVector::getNumWords(getNumBlocks()) * sizeof(uint64_t));
+        m_checkpointBlocks.map(getNumBlocks(), static_cast<const uint64_t*>(p_checkpoint_blocks));
+        const BlockCheckpoint* p_checkpoints = mp_indexFile->getArray<BlockCheckpoint>(FMS_CHECKPOINTS, n);
+        m_checkpoints.map(p_checkpoints, n);
+    }
+
+    // The interval table is optional
+    size_t table_bytes = 0;
+    const void* p_table_info = mp_indexFile->getSection(FMS_INTERVAL_TABLE_INFO, table_bytes);
+    if(p_table_info != NULL)
+    {
+        const IntervalTableInfo* p_table = static_cast<const IntervalTableInfo*>(p_table_info);
+        const uint32_t* p_low = mp_indexFile->getArray<uint32_t>(FMS_INTERVAL_TABLE_LOW, n);
+        assert(n == 2 * p_table->num_entries);
+        const uint8_t* p_high = NULL;
+        if(p_table->has_high_bytes)
+        {
+            p_high = mp_indexFile->getArray<uint8_t>(FMS_INTERVAL_TABLE_HIGH, n);
+            assert(n == 2 * p_table->num_entries);
+        }
+        m_intervalTable.map(*p_table, p_low, p_high);
+    }
+
+    // So is the k-mer filter
+    size_t filter_bytes = 0;
+    const void* p_filter_info = mp_indexFile->getSection(FMS_KMER_FILTER_INFO, filter_bytes);
+    if(p_filter_info != NULL)
+    {
+        const KmerFilterInfo* p_filter = static_cast<const KmerFilterInfo*>(p_filter_info);
+        const uint64_t* p_words = mp_indexFile->getArray<uint64_t>(FMS_KMER_FILTER_BLOCKS, n);
+        assert(n == p_filter->num_blocks * KMER_FILTER_BLOCK_WORDS);
+        m_kmerFilter.map(*p_filter, p_words);
+    }
+
+    initializeEncodedData();
+}
+
+//
+void FMIndex::mapMarkers(uint32_t info_id, uint32_t data_id, PackedMarkerVector& markers)
+{
+    size_t n = 0;
+    const PackedMarkerInfo* p_info = mp_indexFile->getArray<PackedMarkerInfo>(info_id, n);
+    assert(n == 1);
+
+    PackedMarkerVector mapped;
+    mapped.map(*p_info, mp_indexFile->getArray<uint64_t>(data_id, n));
+    assert(n == mapped.getNumWords());
+    markers.swap(mapped);
+}
+
+//
+void FMIndex::save(const std::string& filename) const
+{
+    FMIndexFileInfo info;
+    memset(&info, 0, sizeof(info));
+    info.num_strings = m_numStrings;
+    info.num_symbols = m_numSymbols;
+    info.eof_pos = m_eof_pos;
+    info.large_sample_rate = m_largeSampleRate;
+    info.small_sample_rate = m_smallSampleRate;
+
+    // Store the symbol totals rather than the C(a) array
+    // so the counts can be checked when the file is loaded
+    AlphaCount64 totals = getFullOcc(m_numSymbols - 1);
+    for(size_t i = 0; i < BWT_ALPHABET::size; ++i)
+        info.symbol_counts[i] = totals.getByIdx(i);
+    info.decoder_read_length = isHuffmanBackend() ? m_decoder.getCodeReadLength() : 0;
+    info.backend = m_backend;
+    info.strand_symmetric = m_strandSymmetric;
+
+    const std::vector<PACKED_DECODE_TYPE>* p_table = m_decoder.getTable();
+
+    // The string includes the padding the decoder reads ahead into
+    FMIndexFileWriter writer;
+    writer.addSection(FMS_INFO, &info, sizeof(info));
+    if(isHuffmanBackend())
+        writer.addSection(FMS_DECODER, &(*p_table)[0], p_table->size() * sizeof(PACKED_DECODE_TYPE));
+
+    if(m_backend == FMI_BACKEND_TWO_BIT)
+    {
+        const TwoBitBWTInfo& two_bit = m_twoBit.getInfo();
+        writer.addSection(FMS_TWO_BIT_INFO, &two_bit, sizeof(TwoBitBWTInfo));
+        writer.addSection(FMS_TWO_BIT_BLOCKS, m_twoBit.getBlocks(), two_bit.num_blocks * TWO_BIT_BLOCK_WORDS * sizeof(uint64_t));
+        writer.addSection(FMS_TWO_BIT_DOLLARS, m_twoBit.getDollars(), two_bit.num_dollars * sizeof(uint64_t));
+    }
+    else if(m_backend == FMI_BACKEND_RUN_LENGTH)
+    {
+        const RunLengthBWTInfo& rl = m_runLength.getInfo();
+        const PackedMarkerVector& markers = m_runLength.getMarkers();
+        writer.addSection(FMS_RUN_LENGTH_INFO, &rl, sizeof(RunLengthBWTInfo));
+        writer.addSection(FMS_RUN_LENGTH_UNITS, m_runLength.getUnits(), rl.num_units * sizeof(RLUnit));
+        writer.addSection(FMS_RUN_LENGTH_POSITIONS, m_runLength.getPositions(), rl.num_markers * sizeof(uint64_t));
+        writer.addSection(FMS_RUN_LENGTH_LOOKUP, m_runLength.getLookup(), rl.num_lookup * sizeof(uint32_t));
+        writer.addSection(FMS_RUN_LENGTH_MARKER_INFO, &markers.getInfo(), sizeof(PackedMarkerInfo));
+        writer.addSection(FMS_RUN_LENGTH_MARKERS, markers.getWords(), markers.getNumBytes());
+    }
+    else if(m_backend == FMI_BACKEND_WAVELET_MATRIX)
+    {
+        writer.addSection(FMS_WAVELET_INFO, &m_waveletMatrix.getInfo(), sizeof(WaveletMatrixInfo));
+        for(size_t l = 0; l < WM_LEVELS; ++l)
+        {
+            const RankBitVector& level = m_waveletMatrix.getLevel(l);
+            writer.addSection(FMS_WAVELET_LEVEL_0 + l, level.getWords(), level.getNumBytes());
+        }
+    }
+    else if(m_backend == FMI_BACKEND_HUFFMAN_SUPERBLOCK)
+    {
+        writer.addSection(FMS_SUPERBLOCK_INFO, &m_superblocks.getInfo(), sizeof(SuperblockLayoutInfo));
+        writer.addSection(FMS_SUPERBLOCKS, m_superblocks.getData(), m_superblocks.getNumBytes());
+    }
+    else
+    {
+        writer.addSection(FMS_STRING, m_string.ptr(), m_string.getNumBytes());
+        writer.addSection(FMS_SMALL_MARKER_INFO, &m_smallMarkers.getInfo(), sizeof(PackedMarkerInfo));
+        writer.addSection(FMS_SMALL_MARKERS, m_smallMarkers.getWords(), m_smallMarkers.getNumBytes());
+        writer.addSection(FMS_LARGE_MARKER_INFO, &m_largeMarkers.getInfo(), sizeof(PackedMarkerInfo));
+        writer.addSection(FMS_LARGE_MARKERS, m_largeMarkers.getWords(), m_largeMarkers.getNumBytes());
+        writer.addSection(FMS_REVERSE_BYTES_INFO, &m_reverseBytes.getInfo(), sizeof(PackedMarkerInfo));
+        writer.addSection(FMS_REVERSE_BYTES, m_reverseBytes.getWords(), m_reverseBytes.getNumBytes());
+    }
+
+    if(!m_halfBlockSymbols.empty())
+        writer.addSection(FMS_HALF_BLOCK_SYMBOLS, m_halfBlockSymbols.ptr(), m_halfBlockSymbols.getNumBytes());
+
+    if(!m_checkpoints.empty())
+    {
+        writer.addSection(FMS_CHECKPOINT_BLOCKS, m_checkpointBlocks.getWords(), m_checkpointBlocks.getNumBytes());
+        writer.addSection(FMS_CHECKPOINTS, m_checkpoints.ptr(), m_checkpoints.getNumBytes());
+    }
+
+    if(m_intervalTable.getQ() > 0)
+    {
+        writer.addSection(FMS_INTERVAL_TABLE_INFO, &m_intervalTable.getInfo(), sizeof(IntervalTableInfo));
+        writer.addSection(FMS_INTERVAL_TABLE_LOW, m_intervalTable.getLow(), m_intervalTable.getLowBytes());
+        if(m_intervalTable.getInfo().has_high_bytes)
+            writer.addSection(FMS_INTERVAL_TABLE_HIGH, m_intervalTable.getHigh(), m_intervalTable.getHighBytes());
+    }
+
+    if(m_kmerFilter.getK() > 0)
+    {
+        writer.addSection(FMS_KMER_FILTER_INFO, &m_kmerFilter.getInfo(), sizeof(KmerFilterInfo));
+        writer.addSection(FMS_KMER_FILTER_BLOCKS, m_kmerFilter.getWords(), m_kmerFilter.getNumBytes());
+    }
+    writer.write(filename);
+}
+
+//
+void FMIndex::buildIntervalTable(size_t q)
+{
+    m_intervalTable.initialize(q, m_numSymbols);
+    fillIntervalTable(0, 0, 0, m_numSymbols);
+    m_intervalTable.finalize();
+}
+
+//
+void FMIndex::buildKmerFilter(size_t k, size_t bits_per_kmer)
+{
+    // The number of k-mer positions bounds the number of distinct k-mers.
+    // When both strands are indexed each k-mer is found on both.
+    size_t num_kmers = m_numSymbols - m_numStrings;
+    if(m_strandSymmetric)
+        num_kmers /= 2;
+    m_kmerFilter.initialize(k, num_kmers, bits_per_kmer);
+
+    // The suffixes starting with a terminator sort before those starting with A.
+    // The bwt symbol of each is the last base of a string, or a terminator for
+    // an empty string. The string is read back to its start, where the symbol
+    // is the previous terminator or EOF. Each step reads the symbol of the
+    // row and moves to the row of the previous symbol with one decode.
+    uint64_t mask = k == 32 ? ~0ULL : (1ULL << (2 * k)) - 1;
+    for(size_t i = 0; i < getPC('A'); ++i)
+    {
+        uint64_t fwd = 0;
+        uint64_t rc = 0;
+        size_t len = 0;
+        char b;
+        size_t idx = LFWithChar(i, b);
+        while(b != '$' && b != EOF)
+        {
+            // Prepend b to the k-mer and append its complement to the reverse-complement
+            uint64_t code = BWT_ALPHABET::getRank(b) - 1;
+            fwd = (fwd >> 2) | (code << (2 * (k - 1)));
+            rc = ((rc << 2) | (3 - code)) & mask;
+            if(++len >= k)
+                m_kmerFilter.insert(fwd < rc ? fwd : rc);
+
+            idx = LFWithChar(idx, b);
+        }
+    }
+    m_kmerFilter.finalize();
+}
+
+//
+void FMIndex::fillIntervalTable(size_t depth, size_t code, size_t lower, size_t end)
+{
+    if(depth == m_intervalTable.getInfo().q)
+    {
+        m_intervalTable.set(code, lower, end);
+        return;
+    }
+
+    // Every extension of the interval is counted with one rank pair.
+    // The intervals that are empty are left as initialized.
+    AlphaCount64 occ0, occ1;
+    getFullOccPair(lower - 1, end - 1, occ0, occ1);
+    for(size_t r = 1; r < BWT_ALPHABET::size; ++r)
+    {
+        char b = BWT_ALPHABET::getChar(r);
+        size_t child_lower = getPC(b) + occ0.get(b);
+        size_t child_end = getPC(b) + occ1.get(b);
+        if(child_lower < child_end)
+            fillIntervalTable(depth + 1, code | ((r - 1) << (2 * depth)), child_lower, child_end);
+    }
 }
 
 //
@@ -85,6 +543,334 @@ void FMIndex::setSampleRates(size_t largeSampleRate, size_t smallSampleRate)
     m_largeShiftValue = calculateShiftValue(m_largeSampleRate);
 }
 
+// The state of one search interleaved by findIntervals
+struct BatchSearch
+{
+    size_t pattern_idx;
+    size_t lower;
+    size_t upper;
+    int j;
+    int stage;
+};
+
+// Each step of a search prefetches the markers, then the encoded
+// symbols, then counts, with the other searches run in between
+enum BatchStage
+{
+    BS_PREFETCH_MARKERS,
+    BS_PREFETCH_SYMBOLS,
+    BS_UPDATE
+};
+
+//
+void FMIndex::findIntervals(const std::vector<std::string>& patterns,
+                            std::vector<std::pair<size_t, size_t> >& intervals,
+                            size_t batch_size) const
+{
+    intervals.resize(patterns.size());
+    if(batch_size == 0)
+        batch_size = 1;
+
+    // Only the encoded string of the classic huffman layout is found through a marker
+    int symbols_stage = m_backend == FMI_BACKEND_HUFFMAN ? BS_PREFETCH_SYMBOLS : BS_UPDATE;
+
+    // A slot whose search finishes takes the next pattern
+    std::vector<BatchSearch> slots;
+    slots.reserve(batch_size);
+    size_t next_pattern = 0;
+    size_t num_active = 0;
+    while(next_pattern < patterns.size() || num_active > 0)
+    {
+        while(slots.size() < batch_size && next_pattern < patterns.size())
+        {
+            BatchSearch search;
+            search.pattern_idx = next_pattern++;
+            search.stage = BS_PREFETCH_MARKERS;
+            search.j = startInterval(patterns[search.pattern_idx], search.lower, search.upper);
+            slots.push_back(search);
+            ++num_active;
+        }
+
+        for(size_t i = 0; i < slots.size(); ++i)
+        {
+            BatchSearch& search = slots[i];
+            if(search.j >= 0)
+            {
+                switch(search.stage)
+                {
+                    case BS_PREFETCH_MARKERS:
+                        prefetchCountMarkers(search.lower);
+                        prefetchCountMarkers(search.upper + 1);
+                        search.stage = symbols_stage;
+                        continue;
+                    case BS_PREFETCH_SYMBOLS:
+                        prefetchCountSymbols(search.lower);
+                        prefetchCountSymbols(search.upper + 1);
+                        search.stage = BS_UPDATE;
+                        continue;
+                    default:
+                        if(!extendInterval(search.lower, search.upper, patterns[search.pattern_idx][search.j]))
+                            search.j = -1;
+                        else
+                            --search.j;
+                        search.stage = BS_PREFETCH_MARKERS;
+                        if(search.j >= 0)
+                            continue;
+                        break;
+                }
+            }
+
+            // The search is finished. An empty interval is returned with upper = lower - 1.
+            std::pair<size_t, size_t>& interval = intervals[search.pattern_idx];
+            interval.first = search.lower;
+            interval.second = search.lower <= search.upper ? search.upper : search.lower - 1;
+            --num_active;
+            slots[i] = slots.back();
+            slots.pop_back();
+            --i;
+        }
+    }
+}
+
+//
+size_t FMIndex::select(char b, size_t r) const
+{
+    assert(b != '$');
+    if(isHuffmanBackend())
+        return selectHuffman(b, r);
+
+    // Find the first position where the count exceeds r
+    size_t lower = 0;
+    size_t upper = m_numSymbols - 1;
+    while(lower < upper)
+    {
+        size_t mid = (lower + upper) / 2;
+        if(getOcc(b, mid) > r)
+            upper = mid;
+        else
+            lower = mid + 1;
+    }
+    return lower;
+}
+
+//
+size_t FMIndex::selectHuffman(char b, size_t r) const
+{
+    // The markers are read without decoding so they narrow the search
+    // to the last block starting with at most r occurrences
+    size_t lower_block = 0;
+    size_t upper_block = (m_numSymbols - 1) >> m_smallShiftValue;
+    while(lower_block < upper_block)
+    {
+        size_t mid = (lower_block + upper_block + 1) / 2;
+        if(getInterpolatedMarker(mid).counts.get(b) <= r)
+            lower_block = mid;
+        else
+            upper_block = mid - 1;
+    }
+
+    const LargeMarker marker = getInterpolatedMarker(lower_block);
+    size_t block_start = lower_block << m_smallShiftValue;
+    size_t block_end = std::min(block_start + m_smallSampleRate, m_numSymbols);
+    size_t target = r - marker.counts.get(b);
+    if(!isReverseDecode(block_end - 1))
+        return block_start + selectEncoded(mp_encoded + marker.byteIndex, block_end - block_start, b, target);
+
+    // The first half of a full block is stored forwards and the second half backwards
+    size_t half = m_smallSampleRate >> 1;
+    size_t offset = selectEncoded(mp_encoded + marker.byteIndex, half, b, target);
+    if(offset < half)
+        return block_start + offset;
+
+    const LargeMarker end_marker = getInterpolatedMarker(lower_block + 1);
+    size_t target_from_end = end_marker.counts.get(b) - r - 1;
+    const uint8_t* p_reverse = mp_encoded + getReverseStart(lower_block, end_marker);
+    return block_end - 1 - selectEncoded(p_reverse, block_end - block_start - half, b, target_from_end);
+}
+
+//
+void FMIndex::setBlockCache(BlockCache* p_cache)
+{
+    if(p_cache != NULL && m_smallSampleRate > BLOCK_CACHE_MAX_SYMBOLS)
+    {
+        std::cerr << "Error: blocks of " << m_smallSampleRate << " symbols are too large to cache (the limit is " 
+                  << BLOCK_CACHE_MAX_SYMBOLS << ")\n";
+        exit(EXIT_FAILURE);
+    }
+    mp_blockCache = p_cache;
+}
+
+//
+bool FMIndex::getCachedBlock(size_t block_idx, DecodedBlock& block) const
+{
+    if(mp_blockCache->find(block_idx, block))
+        return true;
+
+    // The summaries tell which blocks hold a $ without decoding them
+    if(!m_halfBlockSymbols.empty() && 
+       ((m_halfBlockSymbols[2 * block_idx] | m_halfBlockSymbols[2 * block_idx + 1]) & 1))
+    {
+        mp_blockCache->reject(block_idx);
+        return false;
+    }
+
+    // Decode the whole block. A full block stores its second half reversed.
+    size_t block_start = block_idx << m_smallShiftValue;
+    size_t num_symbols = std::min(m_smallSampleRate, m_numSymbols - block_start);
+    const LargeMarker marker = getInterpolatedMarker(block_idx);
+    char symbols[BLOCK_CACHE_MAX_SYMBOLS];
+    DECODE_UNIT bits_read = 0;
+    if(num_symbols == m_smallSampleRate)
+    {
+        size_t half = m_smallSampleRate >> 1;
+        StreamEncode::SymbolArrayDecode forward(symbols);
+        StreamEncode::decode(m_decoder, mp_encoded + marker.byteIndex, mp_encodedEnd, half, bits_read, forward);
+
+        const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+        StreamEncode::SymbolArrayDecode reverse(symbols + half);
+        const uint8_t* p_reverse = mp_encoded + getReverseStart(block_idx, end_marker);
+        StreamEncode::decode(m_decoder, p_reverse, mp_encodedEnd, num_symbols - half, bits_read, reverse);
+        std::reverse(symbols + half, symbols + num_symbols);
+    }
+    else
+    {
+        StreamEncode::SymbolArrayDecode forward(symbols);
+        StreamEncode::decode(m_decoder, mp_encoded + marker.byteIndex, mp_encodedEnd, num_symbols, bits_read, forward);
+    }
+
+    if(!block.assign(symbols, num_symbols, marker.counts))
+    {
+        mp_blockCache->reject(block_idx);
+        return false;
+    }
+    mp_blockCache->insert(block_idx, block);
+    return true;
+}
+
+//
+void FMIndex::setBlockProfile(BlockProfile* p_profile)
+{
+    if(p_profile != NULL && p_profile->size() == 0)
+        p_profile->initialize(getNumBlocks());
+
+    if(p_profile != NULL && p_profile->size() != getNumBlocks())
+    {
+        std::cerr << "Error: the block profile has " << p_profile->size() << " blocks but the index has " 
+                  << getNumBlocks() << "\n";
+        exit(EXIT_FAILURE);
+    }
+    mp_blockProfile = p_profile;
+}
+
+//
+size_t FMIndex::addCheckpoints(const BlockProfile& profile, size_t max_bytes)
+{
+    if(!isHuffmanBackend() || m_smallSampleRate < 8 || m_smallSampleRate > MAX_CHECKPOINT_SAMPLE_RATE)
+    {
+        std::cerr << "Error: checkpoints need a huffman-coded index with a sample rate between 8 and " 
+                  << MAX_CHECKPOINT_SAMPLE_RATE << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    size_t num_blocks = getNumBlocks();
+    if(profile.size() != num_blocks)
+    {
+        std::cerr << "Error: the block profile has " << profile.size() << " blocks but the index has " 
+                  << num_blocks << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    // Only full blocks store a reversed half. The bit for each block is paid for
+    // before any checkpoint, so a budget smaller than it adds none.
+    size_t num_full = m_numSymbols >> m_smallShiftValue;
+    size_t vector_bytes = RankBitVector::getNumWords(num_blocks) * sizeof(uint64_t);
+    size_t max_checkpoints = max_bytes > vector_bytes ? (max_bytes - vector_bytes) / sizeof(BlockCheckpoint) : 0;
+
+    std::vector<std::pair<uint64_t, size_t> > hot;
+    for(size_t i = 0; i < num_full; ++i)
+    {
+        if(profile.getCount(i) > 0)
+            hot.push_back(std::make_pair(profile.getCount(i), i));
+    }
+
+    // Keep the most decoded blocks, then put them back in block order
+    if(hot.size() > max_checkpoints)
+    {
+        std::nth_element(hot.begin(), hot.begin() + max_checkpoints, hot.end(), 
+                         std::greater<std::pair<uint64_t, size_t> >());
+        hot.resize(max_checkpoints);
+    }
+
+    std::vector<size_t> blocks(hot.size());
+    for(size_t i = 0; i < hot.size(); ++i)
+        blocks[i] = hot[i].second;
+    std::sort(blocks.begin(), blocks.end());
+
+    // Record where each half is a quarter of a block in, and the counts of that quarter
+    size_t quarter = m_smallSampleRate >> 2;
+    std::vector<BlockCheckpoint> checkpoints(blocks.size());
+    m_checkpointBlocks.initialize(num_blocks);
+    for(size_t i = 0; i < blocks.size(); ++i)
+    {
+        BlockCheckpoint& checkpoint = checkpoints[i];
+        size_t block_idx = blocks[i];
+        m_checkpointBlocks.set(block_idx);
+
+        AlphaCount64 counts;
+        StreamEncode::AlphaCountDecode forward(counts);
+        const LargeMarker marker = getInterpolatedMarker(block_idx);
+        checkpoint.forwardBit = StreamEncode::decodeMultiFrom(m_decoder, mp_encoded + marker.byteIndex, 
+                                                              mp_encodedEnd, 0, quarter, forward);
+        for(size_t j = 0; j < BWT_ALPHABET::size; ++j)
+            checkpoint.forwardCounts[j] = counts.getByIdx(j);
+
+        counts = AlphaCount64();
+        StreamEncode::AlphaCountDecode reverse(counts);
+        const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+        const uint8_t* p_reverse = mp_encoded + getReverseStart(block_idx, end_marker);
+        checkpoint.reverseBit = StreamEncode::decodeMultiFrom(m_decoder, p_reverse, mp_encodedEnd, 0, quarter, reverse);
+        for(size_t j = 0; j < BWT_ALPHABET::size; ++j)
+            checkpoint.reverseCounts[j] = counts.getByIdx(j);
+    }
+    m_checkpointBlocks.finalize();
+    m_checkpoints.swap(checkpoints);
+    return m_checkpoints.size();
+}
+
+//
+size_t FMIndex::selectEncoded(const uint8_t* p_start, size_t num_symbols, char b, size_t target) const
+{
+    // Count a few symbols at a time with the multi-symbol table and only
+    // step through single symbols once the occurrence is within reach
+    static const size_t CHUNK_SYMBOLS = 8;
+    size_t bit = 0;
+    size_t decoded = 0;
+    size_t count = 0;
+    while(decoded < num_symbols)
+    {
+        size_t chunk = std::min(CHUNK_SYMBOLS, num_symbols - decoded);
+        size_t chunk_count = 0;
+        StreamEncode::BaseCountDecode bcd(b, chunk_count);
+        size_t next_bit = StreamEncode::decodeMultiFrom(m_decoder, p_start, mp_encodedEnd, bit, chunk, bcd);
+        if(count + chunk_count > target)
+        {
+            char base = '\0';
+            StreamEncode::SingleBaseDecode sbd(base);
+            while(true)
+            {
+                bit = StreamEncode::decodeMultiFrom(m_decoder, p_start, mp_encodedEnd, bit, 1, sbd);
+                if(base == b && count++ == target)
+                    return decoded;
+                ++decoded;
+            }
+        }
+        count += chunk_count;
+        decoded += chunk;
+        bit = next_bit;
+    }
+    return num_symbols;
+}
+
 // Verify that the index is set up correctly
 // by comparing it to the on-disk version.
 // This is SLOW
@@ -105,9 +891,12 @@ void FMIndex::verify(const std::string& filename)
     while((b = p_reader->readChar()) != '\n')
     {
         // Verify that the symbol at position i matches the symbol
-        // read from the disk
-        char s = getChar(i);
+        // read from the disk, and that LF maps i to the row of the
+        // previous symbol, which follows the earlier occurrences of b
+        char s;
+        size_t lf = LFWithChar(i, s);
         assert(s == b);
+        assert(lf == getPC(b) + running_count.get(b));
 
         // Verifiy that the counts interpolated from the markers
         // are correct
@@ -136,12 +925,15 @@ void FMIndex::print() const
 // Print information about the BWT
 void FMIndex::printInfo() const
 {
-    size_t small_m_size = m_smallMarkers.size() * sizeof(SmallMarker);
-    size_t large_m_size = m_largeMarkers.size() * sizeof(LargeMarker);
-    size_t total_marker_size = small_m_size + large_m_size;
+    size_t small_m_size = m_smallMarkers.getNumBytes();
+    size_t large_m_size = m_largeMarkers.getNumBytes();
+    size_t total_marker_size = small_m_size + large_m_size + m_reverseBytes.getNumBytes();
 
-    size_t bwStr_size = m_string.size();
-    size_t other_size = sizeof(*this);
+    // The superblock layout stores the markers within the string
+    size_t bwStr_size = getNumBytes();
+    size_t checkpoint_size = m_checkpoints.empty() ? 0 : m_checkpoints.getNumBytes() + m_checkpointBlocks.getNumBytes();
+    size_t other_size = sizeof(*this) + m_halfBlockSymbols.getNumBytes() + checkpoint_size +
+                        m_intervalTable.getNumBytes() + m_kmerFilter.getNumBytes();
     size_t total_size = total_marker_size + bwStr_size + other_size;
 
     double mb = (double)(1024 * 1024);
@@ -150,7 +942,66 @@ void FMIndex::printInfo() const
     printf("\nFMIndex info:\n");
     printf("Large Sample rate: %zu\n", m_largeSampleRate);
     printf("Small Sample rate: %zu\n", m_smallSampleRate);
-    printf("Contains %zu symbols in %zu bytes (%1.4lf symbols per byte)\n", m_numSymbols, m_string.size(), (double)m_numSymbols / m_string.size());
+    printf("Contains %zu symbols in %zu bytes (%1.4lf symbols per byte)\n", m_numSymbols, bwStr_size, (double)m_numSymbols / bwStr_size);
+    if(m_strandSymmetric)
+        printf("Strand-symmetric: both strands of every record are indexed\n");
+    if(m_intervalTable.getQ() > 0)
+        printf("Interval table -- q: %zu Entries: %zu Memory: %zu (%.1lf MB)\n", 
+               m_intervalTable.getQ(), (size_t)m_intervalTable.getInfo().num_entries, 
+               m_intervalTable.getNumBytes(), m_intervalTable.getNumBytes() / (1024.0 * 1024.0));
+    if(m_kmerFilter.getK() > 0)
+        printf("K-mer filter -- k: %zu K-mers: %zu Hashes: %zu Memory: %zu (%.1lf MB)\n", 
+               m_kmerFilter.getK(), (size_t)m_kmerFilter.getInfo().num_kmers,
+               (size_t)m_kmerFilter.getInfo().num_hashes,
+               m_kmerFilter.getNumBytes(), m_kmerFilter.getNumBytes() / (1024.0 * 1024.0));
+    if(!m_halfBlockSymbols.empty())
+    {
+        // The share of half-blocks whose counts can be skipped for some symbol
+        size_t single = 0;
+        size_t missing_base = 0;
+        uint8_t bases = ALL_SYMBOLS & ~1;
+        for(size_t i = 0; i < m_halfBlockSymbols.size(); ++i)
+        {
+            uint8_t symbols = m_halfBlockSymbols[i];
+            single += symbols != 0 && (symbols & (symbols - 1)) == 0;
+            missing_base += (symbols & bases) != bases;
+        }
+        printf("Block summaries -- Half-blocks: %zu Single-symbol: %.2lf%% Missing a base: %.2lf%%\n", 
+               m_halfBlockSymbols.size(), 100.0 * single / m_halfBlockSymbols.size(), 
+               100.0 * missing_base / m_halfBlockSymbols.size());
+    }
+    if(!m_checkpoints.empty())
+        printf("Block checkpoints -- Blocks: %zu (%.2lf%%) Memory: %zu (%.1lf MB)\n", 
+               m_checkpoints.size(), 100.0 * m_checkpoints.size() / getNumBlocks(), 
+               checkpoint_size, checkpoint_size / mb);
+    if(m_backend == FMI_BACKEND_HUFFMAN_SUPERBLOCK)
+    {
+        const SuperblockLayoutInfo& layout = m_superblocks.getInfo();
+        printf("Superblock layout -- Record size: %zu bytes Blocks per superblock: %zu\n", 
+               (size_t)layout.record_stride, (size_t)layout.blocks_per_superblock);
+    }
+    else if(m_backend == FMI_BACKEND_TWO_BIT)
+    {
+        printf("Two-bit layout -- Blocks: %zu $ positions: %zu\n", 
+               (size_t)m_twoBit.getInfo().num_blocks, (size_t)m_twoBit.getInfo().num_dollars);
+    }
+    else if(m_backend == FMI_BACKEND_RUN_LENGTH)
+    {
+        const RunLengthBWTInfo& rl = m_runLength.getInfo();
+        printf("Run-length layout -- Runs: %zu Units: %zu Markers: %zu Marker bits: %d\n", 
+               (size_t)rl.num_runs, (size_t)rl.num_units, (size_t)rl.num_markers, 
+               m_runLength.getMarkers().getInfo().entry_bits);
+    }
+    else if(m_backend == FMI_BACKEND_WAVELET_MATRIX)
+    {
+        printf("Wavelet matrix -- Levels: %d Bytes per level: %zu\n", 
+               WM_LEVELS, m_waveletMatrix.getLevel(0).getNumBytes());
+    }
+    else
+    {
+        printf("Marker bits -- Small: %d Large: %d\n", 
+               m_smallMarkers.getInfo().entry_bits, m_largeMarkers.getInfo().entry_bits);
+    }
     printf("Marker Memory -- Small Markers: %zu (%.1lf MB) Large Markers: %zu (%.1lf MB)\n", small_m_size, small_m_size / mb, large_m_size, large_m_size / mb);
     printf("Total Memory -- Markers: %zu (%.1lf MB) Str: %zu (%.1lf MB) Misc: %zu Total: %zu (%lf MB)\n", total_marker_size, total_marker_size / mb, bwStr_size, bwStr_size / mb, other_size, total_size, total_mb);
     printf("N: %zu Bytes per symbol: %lf\n\n", m_numSymbols, (double)total_size / m_numSymbols);
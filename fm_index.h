@@ -14,11 +14,77 @@
 #include "fm_markers.h"
 #include "stream_encoding.h"
 #include "packed_table_decoder.h"
+#include "mapped_vector.h"
+#include "superblock_layout.h"
+#include "two_bit_bwt.h"
+#include "run_length_bwt.h"
+#include "wavelet_matrix.h"
+#include "interval_table.h"
+#include "packed_kmer.h"
+#include "kmer_filter.h"
+#include "block_cache.h"
+#include "block_profile.h"
 
 // Defines
 #define FMINDEX_VALIDATE 1
 
-typedef std::vector<uint8_t> FMBytes;
+typedef MappedVector<uint8_t> FMBytes;
+
+class FMIndexFileReader;
+class IntervalCache;
+
+// The in-memory representation of the bwt, chosen when the index is built
+enum FMIndexBackend
+{
+    // Huffman-coded blocks with separate small and large marker arrays
+    FMI_BACKEND_HUFFMAN = 0,
+
+    // Huffman-coded blocks stored in cache-line aligned records
+    // together with their markers. See superblock_layout.h
+    FMI_BACKEND_HUFFMAN_SUPERBLOCK,
+
+    // Uncompressed 2-bit symbols with popcount rank. See two_bit_bwt.h
+    FMI_BACKEND_TWO_BIT,
+
+    // Run-length encoded symbols for repetitive collections. See run_length_bwt.h
+    FMI_BACKEND_RUN_LENGTH,
+
+    // A wavelet matrix with a fixed cost per query. See wavelet_matrix.h
+    FMI_BACKEND_WAVELET_MATRIX
+};
+
+// Parameters controlling how an FMIndex is built from a bwt file
+struct FMIndexParameters
+{
+    FMIndexParameters();
+
+    size_t smallSampleRate;
+    size_t largeSampleRate;
+    FMIndexBackend backend;
+
+    // Set when the text contains the reverse complement of every record,
+    // as written by bwtdisk-prepare --rc. Every k-mer then occurs on
+    // both strands so a single search answers strand-aware queries.
+    bool strandSymmetric;
+
+    // If non-zero a table of the interval of every string of this many
+    // bases is built, so searches for longer strings skip their first
+    // intervalTableQ steps. The table takes 2 * 4^q bounds.
+    size_t intervalTableQ;
+
+    // If non-zero a Bloom filter of the k-mers of this length is built,
+    // which rejects most absent k-mers before they are searched. It takes
+    // kmerFilterBitsPerKmer bits for each k-mer position of the text;
+    // 10 bits give about 1% false positives and 16 about 0.1%.
+    size_t kmerFilterK;
+    size_t kmerFilterBitsPerKmer;
+
+    // If not empty, the built index is saved to this file
+    std::string outFilename;
+
+    // If set, progress and a summary of the index are printed to stdout
+    bool verbose;
+};
 
 //
 // FMIndex
@@ -28,7 +94,19 @@ class FMIndex
     public:
     
         // Constructors
-        FMIndex(const std::string& filename, int sampleRate = DEFAULT_SAMPLE_RATE_SMALL);
+        // If filename is an index file written by save() it is memory-mapped
+        // and queries are served directly from the mapping. The sample rate
+        // stored in the file is used in this case. Otherwise filename
+        // is taken to be a bwtdisk file and the index is built from it in memory.
+        // If outFilename is given the built index is also saved there.
+        FMIndex(const std::string& filename, 
+                int sampleRate = DEFAULT_SAMPLE_RATE_SMALL,
+                const std::string& outFilename = "");
+        FMIndex(const std::string& filename, const FMIndexParameters& params);
+        ~FMIndex();
+
+        // Write the index to a single file that can be loaded by the constructor
+        void save(const std::string& filename) const;
 
         // test that the FM-index is correctly initialized
         // by checking against the on-disk bwt
@@ -43,37 +121,88 @@ class FMIndex
         bool updateInterval(size_t& lower, size_t& upper, char c) const
         {
                 size_t p = getPC(c);
-                lower = p + getOcc(c, lower - 1);
-                upper = p + getOcc(c, upper) - 1;
+                size_t occ_lower, occ_upper;
+                getOccPair(c, lower - 1, upper, occ_lower, occ_upper);
+                lower = p + occ_lower;
+                upper = p + occ_upper - 1;
                 return lower <= upper;
         }
 
+        // Extend the interval of a suffix of a pattern by c, as updateInterval.
+        // Once the interval is a single row the search follows it with LF while
+        // bwt[row] matches the pattern, which reads one symbol and its count
+        // instead of counting c at both ends of the interval. On a mismatch
+        // the interval is made empty, with upper = lower - 1.
+        inline bool extendInterval(size_t& lower, size_t& upper, char c) const
+        {
+            if(lower != upper)
+                return updateInterval(lower, upper, c);
+
+            size_t occ;
+            if(!matchCharOcc(c, lower, occ))
+            {
+                upper = lower++;
+                return false;
+            }
+            lower = upper = getPC(c) + occ;
+            return true;
+        }
+
         // Return the suffix array interval of the string
         std::pair<size_t, size_t> findInterval(const std::string& s) const
         {
-            assert(!s.empty());
-            int j = s.size() - 1;
-            char curr = s[j];
-            
-            // Initialize interval to the range for the last symbol of s
-            size_t lower = getPC(curr);
-            size_t upper = lower + getOcc(curr, getBWLen() - 1) - 1;
-
-            --j;
+            size_t lower, upper;
+            int j = startInterval(s, lower, upper);
             for(;j >= 0; --j)
             {
-                curr = s[j];
                 // update interval
-                size_t p = getPC(curr);
-                lower = p + getOcc(curr, lower - 1);
-                upper = p + getOcc(curr, upper) - 1;
+                if(!extendInterval(lower, upper, s[j]))
+                    return std::make_pair(lower, lower - 1);
+            }
+            return std::make_pair(lower, upper);
+        }
+
+        // Return the suffix array interval of a packed k-mer. The bases
+        // are read from the packed value so no string is built.
+        template<typename Word>
+        std::pair<size_t, size_t> findInterval(const BasicPackedKmer<Word>& kmer) const
+        {
+            assert(!kmer.empty());
+            size_t lower, upper;
+            int j;
+            size_t q = m_intervalTable.getQ();
+            size_t end;
+            if(q > 0 && kmer.size() >= q && m_intervalTable.findCode(kmer.getSuffixCode(q), lower, end))
+            {
+                if(lower == end)
+                    return std::make_pair(lower, lower - 1);
+                upper = end - 1;
+                j = (int)(kmer.size() - q) - 1;
+            }
+            else
+            {
+                char curr = kmer.getBase(kmer.size() - 1);
+                lower = getPC(curr);
+                upper = lower + getOcc(curr, getBWLen() - 1) - 1;
+                j = (int)kmer.size() - 2;
+            }
 
-                if(lower > upper)
+            for(;j >= 0; --j)
+            {
+                if(!extendInterval(lower, upper, kmer.getBase(j)))
                     return std::make_pair(lower, lower - 1);
             }
             return std::make_pair(lower, upper);
         }
 
+        // Find the suffix array interval of every pattern. Up to batch_size 
+        // searches are advanced in turn, and before moving to the next search
+        // the data the current one will read in its next step is prefetched,
+        // so the cache misses of independent searches overlap.
+        void findIntervals(const std::vector<std::string>& patterns,
+                           std::vector<std::pair<size_t, size_t> >& intervals,
+                           size_t batch_size = DEFAULT_BATCH_SIZE) const;
+
         // Count the number of occurrences of the string s in the original text
         size_t count(const std::string& s) const
         {
@@ -81,6 +210,13 @@ class FMIndex
             return x.second - x.first + 1;
         }
 
+        template<typename Word>
+        size_t count(const BasicPackedKmer<Word>& kmer) const
+        {
+            std::pair<size_t, size_t> x = findInterval(kmer);
+            return x.second - x.first + 1;
+        }
+
         // Perform the LF mapping
         // Let SA[idx] = i.
         // This function returns idx'
@@ -89,29 +225,102 @@ class FMIndex
         // This function will assert if idx == m_eof_pos
         inline size_t LF(size_t idx) const
         {
-            char b = getChar(idx);
+            char b;
+            size_t next = LFWithChar(idx, b);
             assert(b != EOF);
-            size_t p = getPC(b);
-            size_t o = idx > 0 ? getOcc(b, idx - 1) : 0;
-            return p + o;
+            return next;
+        }
+
+        // Perform the LF mapping and set b to bwt[idx], the symbol preceding
+        // the suffix at idx. The symbol and its rank are read with one decode,
+        // where LF followed by getChar would decode the block twice.
+        // Returns idx, with b set to EOF, when SA[idx] = 0.
+        inline size_t LFWithChar(size_t idx, char& b) const
+        {
+            size_t occ;
+            b = getCharOcc(idx, occ);
+            return b == EOF ? idx : getPC(b) + occ;
         }
         
         // Returns BWT[idx]. 
         // This function will return EOF when SA[idx] == 0
         inline char getChar(size_t idx) const
         {
-            // Decompress stream up to the (idx + 1) character and return the last decompressed symbol
-            const LargeMarker marker = getLowerMarker(idx);
-            size_t current_position = marker.getActualPosition();
-            size_t numToCount = idx - current_position + 1;
-            //assert(numToCount < m_smallSampleRate);
-            size_t symbol_index = marker.byteIndex;
-            DECODE_UNIT numBitsRead = 0;
+            if(idx == m_eof_pos)
+                return EOF;
 
-            char outBase = '\0';
-            StreamEncode::SingleBaseDecode sbd(outBase);
-            StreamEncode::decode(m_decoder, &m_string[symbol_index], &m_string.back(), numToCount, numBitsRead, sbd);
-            return idx != m_eof_pos ? outBase : EOF;
+            switch(m_backend)
+            {
+                case FMI_BACKEND_TWO_BIT:
+                    return m_twoBit.getChar(idx);
+                case FMI_BACKEND_RUN_LENGTH:
+                    return m_runLength.getChar(idx);
+                case FMI_BACKEND_WAVELET_MATRIX:
+                    return m_waveletMatrix.getChar(idx);
+                default:
+                    return getHuffmanChar(idx);
+            }
+        }
+
+        // Return bwt[idx] and set occ to the number of times it occurs in bwt[0, idx),
+        // so that LF(idx) = getPC(bwt[idx]) + occ. The symbol and its count are read
+        // with one decode. Returns EOF, leaving occ unset, when SA[idx] = 0.
+        inline char getCharOcc(size_t idx, size_t& occ) const
+        {
+            if(idx == m_eof_pos)
+                return EOF;
+
+            char b;
+            switch(m_backend)
+            {
+                case FMI_BACKEND_TWO_BIT:
+                    // The symbol and its count are read from the same block
+                    b = m_twoBit.getChar(idx);
+                    occ = m_twoBit.getCount(b, idx);
+                    break;
+                case FMI_BACKEND_RUN_LENGTH:
+                    b = m_runLength.getCharCount(idx, occ);
+                    break;
+                case FMI_BACKEND_WAVELET_MATRIX:
+                    b = m_waveletMatrix.getCharCount(idx, occ);
+                    break;
+                default:
+                    b = getHuffmanCharOcc(idx, occ);
+                    break;
+            }
+            occ = adjustEOFCount(b, idx, occ);
+            return b;
+        }
+
+        // Returns true if bwt[idx] is c, and then sets occ to the number of times
+        // c occurs in bwt[0, idx). As getCharOcc, but backends that can compare
+        // the symbol to c without decoding it first do so.
+        inline bool matchCharOcc(char c, size_t idx, size_t& occ) const
+        {
+            if(idx == m_eof_pos)
+                return false;
+
+            switch(m_backend)
+            {
+                case FMI_BACKEND_TWO_BIT:
+                    if(!m_twoBit.matchCount(c, idx, occ))
+                        return false;
+                    break;
+                case FMI_BACKEND_RUN_LENGTH:
+                    if(m_runLength.getCharCount(idx, occ) != c)
+                        return false;
+                    break;
+                case FMI_BACKEND_WAVELET_MATRIX:
+                    if(m_waveletMatrix.getCharCount(idx, occ) != c)
+                        return false;
+                    break;
+                default:
+                    if(!matchHuffmanCharOcc(c, idx, occ))
+                        return false;
+                    break;
+            }
+            occ = adjustEOFCount(c, idx, occ);
+            return true;
         }
 
         // Get the greatest interpolated marker whose position is less than or equal to position
@@ -126,14 +335,22 @@ class FMIndex
         // LargeMarker
         inline LargeMarker getInterpolatedMarker(size_t target_small_idx) const
         {
-            // Calculate the position of the LargeMarker that the SmallMarker is relative to
+            if(m_backend == FMI_BACKEND_HUFFMAN_SUPERBLOCK)
+                return m_superblocks.getMarker(target_small_idx);
+
+            // Calculate the position of the large marker that the small marker is relative to
             size_t target_position = target_small_idx << m_smallShiftValue;
             size_t curr_large_idx = target_position >> m_largeShiftValue;
-            LargeMarker absoluteMarker = m_largeMarkers[curr_large_idx];
-            assert(target_small_idx < m_smallMarkers.size());
-            const SmallMarker& relative = m_smallMarkers[target_small_idx];
-            alphacount_add16(absoluteMarker.counts, relative.counts);
-            absoluteMarker.byteIndex += relative.byteCount;
+            size_t large_position = curr_large_idx << m_largeShiftValue;
+
+            LargeMarker absoluteMarker;
+            m_largeMarkers.get(curr_large_idx, large_position, absoluteMarker.counts, absoluteMarker.byteIndex);
+
+            AlphaCount64 relative;
+            size_t relativeBytes;
+            m_smallMarkers.get(target_small_idx, target_position - large_position, relative, relativeBytes);
+            absoluteMarker.counts += relative;
+            absoluteMarker.byteIndex += relativeBytes;
             return absoluteMarker;
         }
 
@@ -144,22 +361,28 @@ class FMIndex
         {
             // The counts in the marker are not inclusive so we increment the index by 1.
             ++idx;
+            return adjustEOFCount(b, idx, getBackendCount(b, idx));
+        }
 
-            const LargeMarker marker = getLowerMarker(idx);
-            size_t current_position = marker.getActualPosition();
-            size_t numToCount = idx - current_position;
-            assert(numToCount < m_smallSampleRate);
-            size_t running_count = marker.counts.get(b);
-            size_t symbol_index = marker.byteIndex;
-            StreamEncode::BaseCountDecode bcd(b, running_count);
-            DECODE_UNIT numBitsRead = 0;
-            StreamEncode::decode(m_decoder, &m_string[symbol_index], &m_string.back(), numToCount, numBitsRead, bcd);
-            // The EOF marker symbol is stored in the BWT as a '$'.
-            // Subtract one from the count of '$' when the index is
-            // larger than the position of the EOF marker.
-            if (b == '$' && idx > m_eof_pos)
-                --running_count;
-            return running_count;
+        // Set occ0 and occ1 to the number of times char b appears in bwt[0, idx0] 
+        // and bwt[0, idx1]. When both positions are in the same block of the
+        // huffman-coded bwt the block is only located and decoded once.
+        // idx0 may be -1, as when the lower bound of an interval is 0.
+        inline void getOccPair(char b, size_t idx0, size_t idx1, size_t& occ0, size_t& occ1) const
+        {
+            ++idx0;
+            ++idx1;
+            if(isHuffmanBackend())
+            {
+                getHuffmanCountPair(b, idx0, idx1, occ0, occ1);
+            }
+            else
+            {
+                occ0 = getBackendCount(b, idx0);
+                occ1 = getBackendCount(b, idx1);
+            }
+            occ0 = adjustEOFCount(b, idx0, occ0);
+            occ1 = adjustEOFCount(b, idx1, occ1);
         }
 
         // Return the number of times each symbol in the alphabet appears in bwt[0, idx]
@@ -168,30 +391,99 @@ class FMIndex
             // The counts in the marker are not inclusive so we increment the index by 1.
             ++idx;
 
-            const LargeMarker marker = getLowerMarker(idx);
-            size_t current_position = marker.getActualPosition();
-            AlphaCount64 running_count = marker.counts;
-            size_t numToCount = idx - current_position;
+            switch(m_backend)
+            {
+                case FMI_BACKEND_TWO_BIT:
+                    return m_twoBit.getFullCount(idx);
+                case FMI_BACKEND_RUN_LENGTH:
+                    return m_runLength.getFullCount(idx);
+                case FMI_BACKEND_WAVELET_MATRIX:
+                    return m_waveletMatrix.getFullCount(idx);
+                default:
+                    return getHuffmanFullCount(idx);
+            }
+        }
 
-            assert(numToCount < m_smallSampleRate);
-            size_t symbol_index = marker.byteIndex;
-            StreamEncode::AlphaCountDecode acd(running_count);
-            DECODE_UNIT numBitsRead = 0;
-            StreamEncode::decode(m_decoder, &m_string[symbol_index], &m_string.back(), numToCount, numBitsRead, acd);
-            return running_count;
+        // Set occ0 and occ1 to the number of times each symbol in the alphabet
+        // appears in bwt[0, idx0] and bwt[0, idx1], decoding a shared block once
+        inline void getFullOccPair(size_t idx0, size_t idx1, AlphaCount64& occ0, AlphaCount64& occ1) const
+        {
+            if(isHuffmanBackend())
+            {
+                getHuffmanFullCountPair(idx0 + 1, idx1 + 1, occ0, occ1);
+            }
+            else
+            {
+                occ0 = getFullOcc(idx0);
+                occ1 = getFullOcc(idx1);
+            }
         }
 
-        // Return the number of times each symbol in the alphabet appears ins bwt[idx0, idx1]
+        // Return the position of the occurrence of b in the bwt with rank r,
+        // the position i where bwt[i] == b and getOcc(b, i) == r + 1.
+        // b must not be '$'.
+        size_t select(char b, size_t r) const;
+
+        // Return the number of times each symbol in the alphabet appears in bwt(idx0, idx1]
         inline AlphaCount64 getOccDiff(size_t idx0, size_t idx1) const 
         { 
-            return getFullOcc(idx1) - getFullOcc(idx0); 
+            AlphaCount64 occ0, occ1;
+            getFullOccPair(idx0, idx1, occ0, occ1);
+            return occ1 - occ0; 
         }
 
         inline size_t getNumStrings() const { return m_numStrings; } 
+        inline size_t getEOFPos() const { return m_eof_pos; }
+        inline bool isStrandSymmetric() const { return m_strandSymmetric; }
         inline size_t getBWLen() const { return m_numSymbols; }
-        inline size_t getNumBytes() const { return m_string.size(); }
+        inline size_t getNumBytes() const
+        {
+            switch(m_backend)
+            {
+                case FMI_BACKEND_TWO_BIT:
+                    return m_twoBit.getNumBytes();
+                case FMI_BACKEND_RUN_LENGTH:
+                    return m_runLength.getNumBytes();
+                case FMI_BACKEND_WAVELET_MATRIX:
+                    return m_waveletMatrix.getNumBytes();
+                default:
+                    return mp_encodedEnd + 1 - mp_encoded;
+            }
+        }
         inline size_t getSmallSampleRate() const { return m_smallSampleRate; }
 
+        // Use a cache of (k-1)-mer intervals for the de Bruijn graph queries.
+        // The cache is not owned and may be shared by several threads. NULL disables it.
+        inline void setIntervalCache(IntervalCache* p_cache) { mp_intervalCache = p_cache; }
+        inline IntervalCache* getIntervalCache() const { return mp_intervalCache; }
+
+        // Attach a cache of decoded blocks, or NULL to detach it. Counts and
+        // symbol lookups on the huffman backends read blocks from the cache,
+        // decoding and adding the whole block on a miss. The cache is owned by
+        // the caller and may be shared by threads, but not by indices.
+        void setBlockCache(BlockCache* p_cache);
+        inline BlockCache* getBlockCache() const { return mp_blockCache; }
+
+        // Record every block decoded by the huffman backends in a profile, or stop
+        // with NULL. An empty profile is sized to the number of blocks. The profile
+        // is owned by the caller and may be shared by threads.
+        void setBlockProfile(BlockProfile* p_profile);
+        inline BlockProfile* getBlockProfile() const { return mp_blockProfile; }
+
+        // Add checkpoints to the blocks decoded most often in profile, replacing
+        // any the index has, using at most max_bytes. A decode within a block with
+        // a checkpoint reads at most a quarter of the block instead of half.
+        // Only the huffman backends have checkpoints. Returns the number added.
+        size_t addCheckpoints(const BlockProfile& profile, size_t max_bytes);
+        inline size_t getNumCheckpoints() const { return m_checkpoints.size(); }
+        inline bool hasCheckpoint(size_t block_idx) const { return !m_checkpoints.empty() && m_checkpointBlocks.get(block_idx); }
+
+        // Return the number of blocks of the huffman-coded bwt, including the last partial block
+        inline size_t getNumBlocks() const { return (m_numSymbols >> m_smallShiftValue) + 1; }
+
+        // The filter of k-mers consulted before searching for a vertex. Empty if not built.
+        inline const KmerFilter& getKmerFilter() const { return m_kmerFilter; }
+
         // Return the first letter of the suffix starting at idx
         inline char getF(size_t idx) const
         {
@@ -215,19 +507,598 @@ class FMIndex
         friend class BWTReaderAscii;
         friend class BWTWriterAscii;
 
-        // Default sample rates for the large (64-bit) and small (8-bit) occurrence markers
+        // Default sample rates for the large (absolute) and small (relative) occurrence markers
         static const int DEFAULT_SAMPLE_RATE_LARGE = 16384;
         static const int DEFAULT_SAMPLE_RATE_SMALL = 128;
 
+        // The half-block summary that rules nothing out
+        static const uint8_t ALL_SYMBOLS = (1 << BWT_ALPHABET::size) - 1;
+
+        // Default number of searches interleaved by findIntervals
+        static const size_t DEFAULT_BATCH_SIZE = 16;
+
+        // The largest sample rate whose blocks can have checkpoints. The bit offsets
+        // in a checkpoint are 16 bits and a code is at most 4 bits long.
+        static const size_t MAX_CHECKPOINT_SAMPLE_RATE = 16384;
+
     private:
 
 
         // Default constructor is not allowed
         FMIndex() {}
+
+        // The index may refer to a mapped file so copying is not allowed
+        FMIndex(const FMIndex&);
+        FMIndex& operator=(const FMIndex&);
         
         // Load an SGA-encoded bwt
         void loadBWT(const std::string& filename);
 
+        // Map an index file written by save()
+        void loadIndexFile(const std::string& filename);
+        void mapMarkers(uint32_t info_id, uint32_t data_id, PackedMarkerVector& markers);
+
+        // Build the index from a bwt file or map an index file
+        void load(const std::string& filename, const FMIndexParameters& params);
+
+        // Set the predecessor counts from the total symbol counts
+        void initializePredCount(const AlphaCount64& totals);
+
+        // Set the pointers to the encoded data of the backend in use
+        void initializeEncodedData();
+
+        // Set the interval a search for s starts from, that of its last symbol
+        // or of its last q symbols if the interval table has them. Returns the
+        // index of the next symbol to add, or -1 if the search is finished.
+        inline int startInterval(const std::string& s, size_t& lower, size_t& upper) const
+        {
+            assert(!s.empty());
+            size_t q = m_intervalTable.getQ();
+            size_t end;
+            if(q > 0 && s.size() >= q && m_intervalTable.find(s.data() + s.size() - q, lower, end))
+            {
+                upper = end - 1;
+                return lower == end ? -1 : (int)(s.size() - q) - 1;
+            }
+
+            // Initialize interval to the range for the last symbol of s
+            char curr = s[s.size() - 1];
+            lower = getPC(curr);
+            upper = lower + getOcc(curr, getBWLen() - 1) - 1;
+            return (int)s.size() - 2;
+        }
+
+        // Start loading the data a count of bwt[0, n) reads into the cache.
+        // For the huffman-coded blocks in separate arrays this is done in two
+        // stages: the markers, then the encoded symbols the markers point to.
+        inline void prefetchCountMarkers(size_t n) const
+        {
+            switch(m_backend)
+            {
+                case FMI_BACKEND_TWO_BIT:
+                    m_twoBit.prefetch(n);
+                    return;
+                case FMI_BACKEND_RUN_LENGTH:
+                    m_runLength.prefetch(n);
+                    return;
+                case FMI_BACKEND_WAVELET_MATRIX:
+                    m_waveletMatrix.prefetch(n);
+                    return;
+                default:
+                    break;
+            }
+
+            // A count in the second half of a block also reads the marker at its end
+            size_t block_idx = n >> m_smallShiftValue;
+            bool reverse = isReverseDecode(n);
+            if(m_backend == FMI_BACKEND_HUFFMAN_SUPERBLOCK)
+            {
+                m_superblocks.prefetch(block_idx);
+                if(reverse)
+                    m_superblocks.prefetch(block_idx + 1);
+                return;
+            }
+
+            size_t marker_idx = reverse ? block_idx + 1 : block_idx;
+            m_smallMarkers.prefetch(marker_idx);
+            m_largeMarkers.prefetch((marker_idx << m_smallShiftValue) >> m_largeShiftValue);
+            if(reverse)
+                m_reverseBytes.prefetch(block_idx);
+        }
+
+        inline void prefetchCountSymbols(size_t n) const
+        {
+            if(m_backend != FMI_BACKEND_HUFFMAN)
+                return;
+
+            size_t block_idx = n >> m_smallShiftValue;
+            if(isReverseDecode(n))
+            {
+                const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+                __builtin_prefetch(mp_encoded + getReverseStart(block_idx, end_marker));
+            }
+            else
+            {
+                __builtin_prefetch(mp_encoded + getInterpolatedMarker(block_idx).byteIndex);
+            }
+        }
+
+        // Build the table of q-mer intervals by extending every
+        // non-empty interval of depth less than q by each base
+        void buildIntervalTable(size_t q);
+        void fillIntervalTable(size_t depth, size_t code, size_t lower, size_t end);
+
+        // Build the filter of k-mers by reading each string of the text
+        // backwards with LF and adding every k-mer it contains
+        void buildKmerFilter(size_t k, size_t bits_per_kmer);
+
+        // Return the number of times char b appears in bwt[0, n) as stored by the backend
+        inline size_t getBackendCount(char b, size_t n) const
+        {
+            switch(m_backend)
+            {
+                case FMI_BACKEND_TWO_BIT:
+                    return m_twoBit.getCount(b, n);
+                case FMI_BACKEND_RUN_LENGTH:
+                    return m_runLength.getCount(b, n);
+                case FMI_BACKEND_WAVELET_MATRIX:
+                    return m_waveletMatrix.getCount(b, n);
+                default:
+                    return getHuffmanCount(b, n);
+            }
+        }
+
+        // The EOF marker symbol is stored in the BWT as a '$'.
+        // Subtract one from the count of '$' in bwt[0, n) when n is
+        // larger than the position of the EOF marker.
+        inline size_t adjustEOFCount(char b, size_t n, size_t count) const
+        {
+            return b == '$' && n > m_eof_pos ? count - 1 : count;
+        }
+
+        // Returns true if the bwt is stored as huffman-coded blocks
+        inline bool isHuffmanBackend() const
+        {
+            return m_backend == FMI_BACKEND_HUFFMAN || m_backend == FMI_BACKEND_HUFFMAN_SUPERBLOCK;
+        }
+
+        // Full blocks store their second half reversed after the first half.
+        // Positions in the second half are decoded backwards from the
+        // marker at the end of the block so at most half a block is decoded.
+        inline bool isReverseDecode(size_t n) const
+        {
+            size_t block_end = ((n >> m_smallShiftValue) + 1) << m_smallShiftValue;
+            return (n & (m_smallSampleRate - 1)) >= (m_smallSampleRate >> 1) && block_end <= m_numSymbols;
+        }
+
+        // Return the bits of the symbols present in the half-block that a decode
+        // starting or ending at position n reads. The final partial block is given
+        // the symbols of the whole block. Without summaries every symbol is present.
+        inline uint8_t getHalfBlockSymbols(size_t n) const
+        {
+            if(m_halfBlockSymbols.empty())
+                return ALL_SYMBOLS;
+            return m_halfBlockSymbols[n >> (m_smallShiftValue - 1)];
+        }
+
+        // Set count to the number of times b occurs in the num symbols a decode
+        // starting or ending at n would read, if the half-block summary tells: 
+        // when b is absent, or is the only symbol present. Returns false otherwise.
+        inline bool getSummaryCount(char b, size_t n, size_t num, size_t& count) const
+        {
+            uint8_t symbols = getHalfBlockSymbols(n);
+            uint8_t bit = 1 << BWT_ALPHABET::getRank(b);
+            if((symbols & bit) == 0)
+                count = 0;
+            else if(symbols == bit)
+                count = num;
+            else
+                return false;
+            return true;
+        }
+
+        // Return the symbol of a half-block that contains only one, or '\0'
+        inline char getSingleSymbol(size_t n) const
+        {
+            uint8_t symbols = getHalfBlockSymbols(n);
+            if(symbols == 0 || (symbols & (symbols - 1)) != 0)
+                return '\0';
+            return BWT_ALPHABET::getChar(__builtin_ctz(symbols));
+        }
+
+        // Return the offset of the reversed half of the block ending at the given marker
+        inline size_t getReverseStart(size_t block_idx, const LargeMarker& end_marker) const
+        {
+            if(m_backend == FMI_BACKEND_HUFFMAN_SUPERBLOCK)
+                return m_superblocks.getReverseStart(block_idx);
+
+            AlphaCount64 unused;
+            size_t reverse_bytes;
+            m_reverseBytes.get(block_idx, 0, unused, reverse_bytes);
+            return end_marker.byteIndex - reverse_bytes;
+        }
+
+        // Return the checkpoint of the block that a decode of num symbols from
+        // either end can start from, or NULL if the block has none or the decode
+        // does not pass it. The decode is recorded in the block profile, if any.
+        inline const BlockCheckpoint* findCheckpoint(size_t block_idx, size_t num) const
+        {
+            if(mp_blockProfile != NULL)
+                mp_blockProfile->record(block_idx);
+            if(num <= (m_smallSampleRate >> 2) || !hasCheckpoint(block_idx))
+                return NULL;
+            return &m_checkpoints[m_checkpointBlocks.rank1(block_idx)];
+        }
+
+        // Decode the first num symbols of the forward half of a block, starting
+        // at p_start, into functor. A block with a checkpoint starts from it when
+        // num covers its first quarter. Returns the bit after the last symbol.
+        template<typename Functor>
+        inline size_t decodeForward(size_t block_idx, const uint8_t* p_start, size_t num, Functor& functor) const
+        {
+            size_t bit = 0;
+            const BlockCheckpoint* p_check = findCheckpoint(block_idx, num);
+            if(p_check != NULL)
+            {
+                functor.skip(p_check->forwardCounts);
+                bit = p_check->forwardBit;
+                num -= m_smallSampleRate >> 2;
+            }
+            return StreamEncode::decodeMultiFrom(m_decoder, p_start, mp_encodedEnd, bit, num, functor);
+        }
+
+        // As decodeForward for the reversed half starting at p_start, skipping its last quarter
+        template<typename Functor>
+        inline size_t decodeReverse(size_t block_idx, const uint8_t* p_start, size_t num, Functor& functor) const
+        {
+            size_t bit = 0;
+            const BlockCheckpoint* p_check = findCheckpoint(block_idx, num);
+            if(p_check != NULL)
+            {
+                functor.skip(p_check->reverseCounts);
+                bit = p_check->reverseBit;
+                num -= m_smallSampleRate >> 2;
+            }
+            return StreamEncode::decodeMultiFrom(m_decoder, p_start, mp_encodedEnd, bit, num, functor);
+        }
+
+        // Decode bwt[idx] from the huffman-coded blocks
+        inline char getHuffmanChar(size_t idx) const
+        {
+            char single = getSingleSymbol(idx);
+            if(single != '\0')
+                return single;
+
+            DecodedBlock block;
+            if(mp_blockCache != NULL && getCachedBlock(idx >> m_smallShiftValue, block))
+                return block.getChar(idx & (m_smallSampleRate - 1));
+
+            char outBase = '\0';
+            StreamEncode::SingleBaseDecode sbd(outBase);
+            if(isReverseDecode(idx))
+            {
+                // Decompress the reversed half back to idx and return the last decompressed symbol
+                size_t block_idx = idx >> m_smallShiftValue;
+                const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+                size_t numToCount = ((block_idx + 1) << m_smallShiftValue) - idx;
+                const uint8_t* p_start = mp_encoded + getReverseStart(block_idx, end_marker);
+                decodeReverse(block_idx, p_start, numToCount, sbd);
+                return outBase;
+            }
+
+            // Decompress stream up to the (idx + 1) character and return the last decompressed symbol
+            const LargeMarker marker = getLowerMarker(idx);
+            size_t current_position = marker.getActualPosition();
+            size_t numToCount = idx - current_position + 1;
+            size_t symbol_index = marker.byteIndex;
+            decodeForward(idx >> m_smallShiftValue, mp_encoded + symbol_index, numToCount, sbd);
+            return outBase;
+        }
+
+        // Decode bwt[idx] and count its occurrences in bwt[0, idx) using the huffman-coded blocks
+        inline char getHuffmanCharOcc(size_t idx, size_t& occ) const
+        {
+            DecodedBlock block;
+            if(mp_blockCache != NULL && getCachedBlock(idx >> m_smallShiftValue, block))
+            {
+                size_t r = idx & (m_smallSampleRate - 1);
+                char b = block.getChar(r);
+                occ = block.getCount(b, r);
+                return b;
+            }
+
+            int rank = 0;
+            if(isReverseDecode(idx))
+            {
+                // The symbols decoded back from the end of the block include bwt[idx] itself
+                size_t block_idx = idx >> m_smallShiftValue;
+                const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+                size_t numToCount = ((block_idx + 1) << m_smallShiftValue) - idx;
+                char single = getSingleSymbol(idx);
+                if(single != '\0')
+                {
+                    occ = end_marker.counts.get(single) - numToCount;
+                    return single;
+                }
+
+                AlphaCount64 after_count;
+                StreamEncode::CharCountDecode ccd(after_count, rank);
+                const uint8_t* p_start = mp_encoded + getReverseStart(block_idx, end_marker);
+                decodeReverse(block_idx, p_start, numToCount, ccd);
+                char b = BWT_ALPHABET::getChar(rank);
+                occ = end_marker.counts.get(b) - after_count.get(b);
+                return b;
+            }
+
+            // Decode up to and including bwt[idx], then remove it from its own count
+            const LargeMarker marker = getLowerMarker(idx);
+            size_t numToCount = idx - marker.getActualPosition() + 1;
+            char single = getSingleSymbol(idx);
+            if(single != '\0')
+            {
+                occ = marker.counts.get(single) + numToCount - 1;
+                return single;
+            }
+
+            AlphaCount64 running_count = marker.counts;
+            StreamEncode::CharCountDecode ccd(running_count, rank);
+            decodeForward(idx >> m_smallShiftValue, mp_encoded + marker.byteIndex, numToCount, ccd);
+            char b = BWT_ALPHABET::getChar(rank);
+            occ = running_count.get(b) - 1;
+            return b;
+        }
+
+        // As getHuffmanCharOcc but only c is counted
+        inline bool matchHuffmanCharOcc(char c, size_t idx, size_t& occ) const
+        {
+            // The summary rules out c when it is absent from the half-block or
+            // another symbol fills it, and gives the count when c fills it
+            uint8_t symbols = getHalfBlockSymbols(idx);
+            uint8_t bit = 1 << BWT_ALPHABET::getRank(c);
+            if((symbols & bit) == 0)
+                return false;
+            bool single = symbols == bit;
+
+            DecodedBlock block;
+            if(mp_blockCache != NULL && getCachedBlock(idx >> m_smallShiftValue, block))
+            {
+                size_t r = idx & (m_smallSampleRate - 1);
+                if(block.getChar(r) != c)
+                    return false;
+                occ = block.getCount(c, r);
+                return true;
+            }
+
+            int rank = 0;
+            if(isReverseDecode(idx))
+            {
+                size_t block_idx = idx >> m_smallShiftValue;
+                const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+                size_t numToCount = ((block_idx + 1) << m_smallShiftValue) - idx;
+                if(single)
+                {
+                    occ = end_marker.counts.get(c) - numToCount;
+                    return true;
+                }
+
+                size_t after_count = 0;
+                StreamEncode::BaseCountLastDecode bcd(c, after_count, rank);
+                const uint8_t* p_start = mp_encoded + getReverseStart(block_idx, end_marker);
+                decodeReverse(block_idx, p_start, numToCount, bcd);
+                occ = end_marker.counts.get(c) - after_count;
+                return rank == BWT_ALPHABET::getRank(c);
+            }
+
+            const LargeMarker marker = getLowerMarker(idx);
+            size_t numToCount = idx - marker.getActualPosition() + 1;
+            occ = marker.counts.get(c);
+            if(single)
+            {
+                occ += numToCount - 1;
+                return true;
+            }
+
+            StreamEncode::BaseCountLastDecode bcd(c, occ, rank);
+            decodeForward(idx >> m_smallShiftValue, mp_encoded + marker.byteIndex, numToCount, bcd);
+            if(rank != BWT_ALPHABET::getRank(c))
+                return false;
+            --occ;
+            return true;
+        }
+
+        // Count the occurrences of b in bwt[0, n) using the huffman-coded blocks
+        inline size_t getHuffmanCount(char b, size_t n) const
+        {
+            DecodedBlock block;
+            if(mp_blockCache != NULL && getCachedBlock(n >> m_smallShiftValue, block))
+                return block.getCount(b, n & (m_smallSampleRate - 1));
+
+            if(isReverseDecode(n))
+            {
+                // Subtract the occurrences in bwt[n, end) from the counts at the end of the block
+                size_t block_idx = n >> m_smallShiftValue;
+                const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+                size_t numToCount = ((block_idx + 1) << m_smallShiftValue) - n;
+                size_t after_count = 0;
+                if(!getSummaryCount(b, n, numToCount, after_count))
+                {
+                    StreamEncode::BaseCountDecode bcd(b, after_count);
+                    const uint8_t* p_start = mp_encoded + getReverseStart(block_idx, end_marker);
+                    decodeReverse(block_idx, p_start, numToCount, bcd);
+                }
+                return end_marker.counts.get(b) - after_count;
+            }
+
+            const LargeMarker marker = getLowerMarker(n);
+            size_t current_position = marker.getActualPosition();
+            size_t numToCount = n - current_position;
+            assert(numToCount < m_smallSampleRate);
+            size_t running_count = marker.counts.get(b);
+            size_t summary_count;
+            if(getSummaryCount(b, n, numToCount, summary_count))
+                return running_count + summary_count;
+
+            size_t symbol_index = marker.byteIndex;
+            StreamEncode::BaseCountDecode bcd(b, running_count);
+            decodeForward(n >> m_smallShiftValue, mp_encoded + symbol_index, numToCount, bcd);
+            return running_count;
+        }
+
+        // Count the occurrences of every symbol in bwt[0, n) using the huffman-coded blocks
+        inline AlphaCount64 getHuffmanFullCount(size_t n) const
+        {
+            DecodedBlock block;
+            if(mp_blockCache != NULL && getCachedBlock(n >> m_smallShiftValue, block))
+                return block.getFullCount(n & (m_smallSampleRate - 1));
+
+            if(isReverseDecode(n))
+            {
+                size_t block_idx = n >> m_smallShiftValue;
+                const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+                size_t numToCount = ((block_idx + 1) << m_smallShiftValue) - n;
+                AlphaCount64 after_count;
+                char single = getSingleSymbol(n);
+                if(single != '\0')
+                {
+                    after_count.set(single, numToCount);
+                    return end_marker.counts - after_count;
+                }
+
+                StreamEncode::AlphaCountDecode acd(after_count);
+                const uint8_t* p_start = mp_encoded + getReverseStart(block_idx, end_marker);
+                decodeReverse(block_idx, p_start, numToCount, acd);
+                return end_marker.counts - after_count;
+            }
+
+            const LargeMarker marker = getLowerMarker(n);
+            size_t current_position = marker.getActualPosition();
+            AlphaCount64 running_count = marker.counts;
+            size_t numToCount = n - current_position;
+
+            assert(numToCount < m_smallSampleRate);
+            char single = getSingleSymbol(n);
+            if(single != '\0')
+            {
+                running_count.add(single, numToCount);
+                return running_count;
+            }
+
+            size_t symbol_index = marker.byteIndex;
+            StreamEncode::AlphaCountDecode acd(running_count);
+            decodeForward(n >> m_smallShiftValue, mp_encoded + symbol_index, numToCount, acd);
+            return running_count;
+        }
+
+        // Return true if bwt[0, n0) and bwt[0, n1) can be counted with one decode:
+        // both positions are in the same block and the same half of it
+        inline bool isSharedDecode(size_t n0, size_t n1) const
+        {
+            return n0 <= n1 && (n0 >> m_smallShiftValue) == (n1 >> m_smallShiftValue) &&
+                   isReverseDecode(n0) == isReverseDecode(n1);
+        }
+
+        // Copy the decoded block with the given index from the block cache, decoding
+        // and adding it on a miss. Returns false if the block holds a $ and so
+        // cannot be cached.
+        bool getCachedBlock(size_t block_idx, DecodedBlock& block) const;
+
+        // Find the occurrence of b with rank r using the huffman-coded blocks
+        size_t selectHuffman(char b, size_t r) const;
+
+        // Return the offset of the occurrence of b with rank target among the 
+        // num_symbols symbols encoded from p_start, or num_symbols if there is none
+        size_t selectEncoded(const uint8_t* p_start, size_t num_symbols, char b, size_t target) const;
+
+        // Count the occurrences of b in bwt[0, n0) and bwt[0, n1) using the huffman-coded blocks
+        inline void getHuffmanCountPair(char b, size_t n0, size_t n1, size_t& occ0, size_t& occ1) const
+        {
+            if(mp_blockCache != NULL || !isSharedDecode(n0, n1))
+            {
+                occ0 = getHuffmanCount(b, n0);
+                occ1 = getHuffmanCount(b, n1);
+                return;
+            }
+
+            size_t block_idx = n1 >> m_smallShiftValue;
+            size_t summary_count0, summary_count1;
+            if(isReverseDecode(n1))
+            {
+                // Decode backwards to n1 then continue to n0
+                const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+                size_t end_count = end_marker.counts.get(b);
+                size_t block_end = (block_idx + 1) << m_smallShiftValue;
+                if(getSummaryCount(b, n0, block_end - n0, summary_count0))
+                {
+                    getSummaryCount(b, n1, block_end - n1, summary_count1);
+                    occ0 = end_count - summary_count0;
+                    occ1 = end_count - summary_count1;
+                    return;
+                }
+
+                size_t after_count = 0;
+                StreamEncode::BaseCountDecode bcd(b, after_count);
+                const uint8_t* p_start = mp_encoded + getReverseStart(block_idx, end_marker);
+                size_t bit = decodeReverse(block_idx, p_start, ((block_idx + 1) << m_smallShiftValue) - n1, bcd);
+                occ1 = end_count - after_count;
+                StreamEncode::decodeMultiFrom(m_decoder, p_start, mp_encodedEnd, bit, n1 - n0, bcd);
+                occ0 = end_count - after_count;
+                return;
+            }
+
+            // Decode forwards to n0 then continue to n1
+            const LargeMarker marker = getInterpolatedMarker(block_idx);
+            size_t running_count = marker.counts.get(b);
+            size_t block_start = block_idx << m_smallShiftValue;
+            if(getSummaryCount(b, n1, n1 - block_start, summary_count1))
+            {
+                getSummaryCount(b, n0, n0 - block_start, summary_count0);
+                occ0 = running_count + summary_count0;
+                occ1 = running_count + summary_count1;
+                return;
+            }
+
+            StreamEncode::BaseCountDecode bcd(b, running_count);
+            const uint8_t* p_start = mp_encoded + marker.byteIndex;
+            size_t bit = decodeForward(block_idx, p_start, n0 - (block_idx << m_smallShiftValue), bcd);
+            occ0 = running_count;
+            StreamEncode::decodeMultiFrom(m_decoder, p_start, mp_encodedEnd, bit, n1 - n0, bcd);
+            occ1 = running_count;
+        }
+
+        // Count the occurrences of every symbol in bwt[0, n0) and bwt[0, n1) using the huffman-coded blocks
+        inline void getHuffmanFullCountPair(size_t n0, size_t n1, AlphaCount64& occ0, AlphaCount64& occ1) const
+        {
+            if(mp_blockCache != NULL || !isSharedDecode(n0, n1))
+            {
+                occ0 = getHuffmanFullCount(n0);
+                occ1 = getHuffmanFullCount(n1);
+                return;
+            }
+
+            size_t block_idx = n1 >> m_smallShiftValue;
+            if(isReverseDecode(n1))
+            {
+                const LargeMarker end_marker = getInterpolatedMarker(block_idx + 1);
+                AlphaCount64 after_count;
+                StreamEncode::AlphaCountDecode acd(after_count);
+                const uint8_t* p_start = mp_encoded + getReverseStart(block_idx, end_marker);
+                size_t bit = decodeReverse(block_idx, p_start, ((block_idx + 1) << m_smallShiftValue) - n1, acd);
+                occ1 = end_marker.counts - after_count;
+                StreamEncode::decodeMultiFrom(m_decoder, p_start, mp_encodedEnd, bit, n1 - n0, acd);
+                occ0 = end_marker.counts - after_count;
+                return;
+            }
+
+            const LargeMarker marker = getInterpolatedMarker(block_idx);
+            AlphaCount64 running_count = marker.counts;
+            StreamEncode::AlphaCountDecode acd(running_count);
+            const uint8_t* p_start = mp_encoded + marker.byteIndex;
+            size_t bit = decodeForward(block_idx, p_start, n0 - (block_idx << m_smallShiftValue), acd);
+            occ0 = running_count;
+            StreamEncode::decodeMultiFrom(m_decoder, p_start, mp_encodedEnd, bit, n1 - n0, acd);
+            occ1 = running_count;
+        }
+
         // this class consumes huffman codes and emits the symbols they represent
         PackedTableDecoder m_decoder;
 
@@ -238,8 +1109,62 @@ class FMIndex
         FMBytes m_string;
 
         // The marker vectors
-        LargeMarkerVector m_largeMarkers;
-        SmallMarkerVector m_smallMarkers;
+        PackedMarkerVector m_largeMarkers;
+        PackedMarkerVector m_smallMarkers;
+
+        // The byte length of the reversed second half of each block,
+        // stored in the offset field of an otherwise empty marker
+        PackedMarkerVector m_reverseBytes;
+
+        // A bit for each symbol present in each half of each block of the
+        // huffman-coded bwt, so some counts are answered without decoding
+        FMBytes m_halfBlockSymbols;
+
+        // Checkpoints within the most frequently decoded blocks, in block order,
+        // and a bit for each block marking the blocks that have one
+        MappedVector<BlockCheckpoint> m_checkpoints;
+        RankBitVector m_checkpointBlocks;
+
+        // The alternative layout of the encoded string and markers
+        SuperblockLayout m_superblocks;
+
+        // The uncompressed bwt used by the two-bit backend
+        TwoBitBWT m_twoBit;
+
+        // The run-length encoded bwt used by the run-length backend
+        RunLengthBWT m_runLength;
+
+        // The wavelet matrix used by the wavelet matrix backend
+        WaveletMatrix m_waveletMatrix;
+
+        // The intervals of short strings, used to start searches. Empty if not built.
+        IntervalTable m_intervalTable;
+
+        // The k-mers of one length, checked before searching for a vertex. Empty if not built.
+        KmerFilter m_kmerFilter;
+
+        // The mapped index file backing the vectors above, if any
+        FMIndexFileReader* mp_indexFile;
+
+        // The cache consulted by the graph queries, if any
+        IntervalCache* mp_intervalCache;
+
+        // The cache of decoded blocks used by the huffman backends, if any
+        BlockCache* mp_blockCache;
+
+        // The histogram the huffman backends record their block decodes in, if any
+        BlockProfile* mp_blockProfile;
+
+        // The representation of the bwt
+        FMIndexBackend m_backend;
+
+        // Whether the text contains both strands of every record
+        bool m_strandSymmetric;
+
+        // The first and last byte of the encoded symbols. Marker byte
+        // indices are relative to mp_encoded.
+        const uint8_t* mp_encoded;
+        const uint8_t* mp_encodedEnd;
 
         // The number of strings in the collection
         size_t m_numStrings;
@@ -263,4 +1188,18 @@ class FMIndex
         int m_largeShiftValue;
 
 };
+
+//
+inline FMIndexParameters::FMIndexParameters() : smallSampleRate(FMIndex::DEFAULT_SAMPLE_RATE_SMALL),
+                                                largeSampleRate(FMIndex::DEFAULT_SAMPLE_RATE_LARGE),
+                                                backend(FMI_BACKEND_HUFFMAN),
+                                                strandSymmetric(false),
+                                                intervalTableQ(0),
+                                                kmerFilterK(0),
+                                                kmerFilterBitsPerKmer(10),
+                                                verbose(true)
+{
+
+}
+
 #endif
@@ -17,48 +17,17 @@ FMIndexBuilder::FMIndexBuilder(const std::string& filename,
                                size_t small_sample_rate,
                                size_t large_sample_rate)
 {
-    // Create temporary files for the 3 components of the index
-    mp_str_tmp = new std::ofstream(getStringFilename().c_str(), std::ios::binary);
-    mp_sm_tmp = new std::ofstream(getSmallMarkerFilename().c_str(), std::ios::binary);
-    mp_lm_tmp = new std::ofstream(getLargeMarkerFilename().c_str(), std::ios::binary);
-
     m_small_sample_rate = small_sample_rate;
     m_large_sample_rate = large_sample_rate;
 
-
     build(filename);
 }
 
-FMIndexBuilder::~FMIndexBuilder()
-{
-    assert(mp_str_tmp == NULL);
-    assert(mp_sm_tmp == NULL);
-    assert(mp_lm_tmp == NULL);
-}
-
-std::string FMIndexBuilder::getStringFilename() const
-{
-    return "dbgfm.str";
-}
-
-std::string FMIndexBuilder::getSmallMarkerFilename() const
-{
-    return "dbgfm.sm";
-
-}
-
-std::string FMIndexBuilder::getLargeMarkerFilename() const
-{
-    return "dbgfm.lm";
-}
-
 void FMIndexBuilder::build(const std::string& filename)
 {
     // Initialization
     m_str_bytes = 0;
     m_str_symbols = 0;
-    m_num_large_markers_wrote = 0;
-    m_num_small_markers_wrote = 0;
 
     //
     // Step 1: make a symbol -> count map and use it to build a huffman tree
@@ -81,6 +50,46 @@ void FMIndexBuilder::build(const std::string& filename)
     assert(count_map['$'] > 1);
     m_strings = count_map['$'] - 1;
 
+    // Size the output buffers from the symbol counts so they are not reallocated as they grow.
+    // Each segment is padded to a byte boundary.
+    AlphaCount64 totals;
+    size_t num_symbols = 0;
+    for(std::map<char, size_t>::iterator iter = count_map.begin(); iter != count_map.end(); ++iter)
+    {
+        totals.set(iter->first, iter->second);
+        num_symbols += iter->second;
+    }
+    size_t num_segments = (num_symbols + m_small_sample_rate - 1) / m_small_sample_rate;
+    size_t max_bytes = encoder.getRequiredBits(count_map) / BITS_PER_BYTE + num_segments;
+    m_string.reserve(max_bytes + DECODE_UNIT_BYTES);
+
+    // There is a small marker at the start of every segment, plus one past the last
+    // symbol when the length is a multiple of the sample rate, so getOcc(n - 1) has a marker
+    size_t num_small_markers = num_symbols / m_small_sample_rate + 1;
+    size_t last_marker_position = (num_small_markers - 1) * m_small_sample_rate;
+    size_t num_large_markers = last_marker_position / m_large_sample_rate + 1;
+
+    // The large markers store absolute counts and byte indices
+    m_largeMarkers.initialize(num_large_markers, totals, max_bytes);
+
+    // The small markers store counts and byte offsets relative to the preceding large marker
+    size_t max_relative_symbols = m_large_sample_rate - m_small_sample_rate;
+    AlphaCount64 max_relative_counts;
+    for(size_t i = 0; i < BWT_ALPHABET::size; ++i)
+        max_relative_counts.setByIdx(i, std::min(totals.getByIdx(i), max_relative_symbols));
+    size_t max_relative_bytes = (max_relative_symbols * encoder.getMaxBits() + BITS_PER_BYTE - 1) / BITS_PER_BYTE +
+                                m_large_sample_rate / m_small_sample_rate;
+    m_smallMarkers.initialize(num_small_markers, max_relative_counts, std::min(max_bytes, max_relative_bytes));
+
+    // The byte length of the reversed second half of each block. Only the offset field is used.
+    size_t max_reverse_bytes = ((m_small_sample_rate - m_small_sample_rate / 2) * encoder.getMaxBits() + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+    m_reverseBytes.initialize(num_small_markers, AlphaCount64(), max_reverse_bytes);
+
+    // One summary for each half of the block at every small marker
+    m_halfBlockSymbols.assign(2 * num_small_markers, 0);
+    m_num_small_markers = 0;
+    m_num_large_markers = 0;
+
     /*
     for(std::map<char, size_t>::iterator iter = count_map.begin();
         iter != count_map.end(); ++iter) {
@@ -116,17 +125,19 @@ void FMIndexBuilder::build(const std::string& filename)
     if(!buffer.empty())
         buildSegment(encoder, buffer);
 
+    // Place the markers for the position one past the last symbol
+    // if it was not placed at the start of a segment
+    if(m_num_small_markers < m_smallMarkers.size())
+        buildMarkers();
+    assert(m_num_small_markers == m_smallMarkers.size());
+    assert(m_num_large_markers == m_largeMarkers.size());
+
     m_eof_pos = p_reader->getEOFPos();
 
     delete p_reader;
 
-    delete mp_str_tmp;
-    delete mp_sm_tmp;
-    delete mp_lm_tmp;
-
-    mp_str_tmp = NULL;
-    mp_sm_tmp = NULL;
-    mp_lm_tmp = NULL;
+    // Pad the string so the decoder can prime its buffer at any byte
+    m_string.resize(m_str_bytes + DECODE_UNIT_BYTES, 0);
 }
 
 void FMIndexBuilder::buildSegment(HuffmanTreeCodec<char>& encoder,
@@ -139,20 +150,58 @@ void FMIndexBuilder::buildSegment(HuffmanTreeCodec<char>& encoder,
     for(size_t i = 0; i < buffer.size(); ++i)
         m_runningAC.increment(buffer[i]);
 
-    // make a buffer that is large enough to store the encoded data in the worst case
+    // A full block is stored as its first half followed by its second
+    // half in reverse order so it can be decoded from either end.
+    // The final partial block is only decoded forward.
+    if(buffer.size() == m_small_sample_rate)
+    {
+        size_t half = buffer.size() / 2;
+        setHalfBlockSymbols(buffer, 0, half, 0);
+        setHalfBlockSymbols(buffer, half, buffer.size(), 1);
+        std::deque<char> forward(buffer.begin(), buffer.begin() + half);
+        std::deque<char> reverse(buffer.rbegin(), buffer.rbegin() + (buffer.size() - half));
+        encodeSegment(encoder, forward);
+        size_t reverse_bytes = encodeSegment(encoder, reverse);
+        m_reverseBytes.set(m_num_small_markers - 1, AlphaCount64(), reverse_bytes);
+    }
+    else
+    {
+        // The final block is decoded forward from its start, so both
+        // halves are given the symbols of the whole block
+        setHalfBlockSymbols(buffer, 0, buffer.size(), 0);
+        setHalfBlockSymbols(buffer, 0, buffer.size(), 1);
+        encodeSegment(encoder, buffer);
+    }
+
+    m_str_symbols += buffer.size();
+}
+
+void FMIndexBuilder::setHalfBlockSymbols(const std::deque<char>& buffer, 
+                                         size_t begin, size_t end, size_t half)
+{
+    uint8_t symbols = 0;
+    for(size_t i = begin; i < end; ++i)
+        symbols |= 1 << BWT_ALPHABET::getRank(buffer[i]);
+    m_halfBlockSymbols[2 * (m_num_small_markers - 1) + half] = symbols;
+}
+
+size_t FMIndexBuilder::encodeSegment(HuffmanTreeCodec<char>& encoder,
+                                     const std::deque<char>& buffer)
+{
+    // make a buffer that is large enough to store the encoded data in the worst case,
+    // plus room for the decoder to read ahead when checking the encoding
     size_t max_bits = encoder.getMaxBits() * buffer.size();
-    size_t max_bytes = max_bits / 8;
-    std::vector<uint8_t> output(max_bytes, 0);
+    size_t max_bytes = (max_bits + BITS_PER_BYTE - 1) / BITS_PER_BYTE + DECODE_UNIT_BYTES;
+    std::vector<uint8_t>& output = m_segment;
+    output.assign(max_bytes, 0);
 
     size_t bytes = StreamEncode::encode(buffer, encoder, output);
-    mp_str_tmp->write(reinterpret_cast<const char*>(&output[0]), bytes);
+    m_string.insert(m_string.end(), output.begin(), output.begin() + bytes);
 
     DECODE_UNIT bits_read = 0;
-    PackedTableDecoder decoder;
-    decoder.initialize(encoder);
     std::string str;
     StreamEncode::StringDecode sd(str);
-    StreamEncode::decode(decoder, &output[0], &output[0] + output.size() - 1, buffer.size(), bits_read, sd);
+    StreamEncode::decode(m_decoder, &output[0], &output[0] + output.size() - 1, buffer.size(), bits_read, sd);
 
     std::string e;
     for(size_t i = 0; i < buffer.size(); ++i)
@@ -162,8 +211,8 @@ void FMIndexBuilder::buildSegment(HuffmanTreeCodec<char>& encoder,
 //    printf("E: %s\n", e.c_str());
 //    printf("D: %s\n", str.c_str());
 
-    m_str_symbols += buffer.size();
     m_str_bytes += bytes;
+    return bytes;
 }
 
 void FMIndexBuilder::buildMarkers()
@@ -171,42 +220,17 @@ void FMIndexBuilder::buildMarkers()
     size_t starting_byte = m_str_bytes;
 
     // Do we need to place new large markers?
-    while((m_str_symbols / m_large_sample_rate) + 1 > m_num_large_markers_wrote)
+    while((m_str_symbols / m_large_sample_rate) + 1 > m_num_large_markers)
     {
         // Build a new large marker with the accumulated counts up to this point
         LargeMarker marker;
         marker.byteIndex = starting_byte;
         marker.counts = m_runningAC;
         m_prevLargeMarker = marker;
-
-        // Write the marker to the temp file
-        mp_lm_tmp->write(reinterpret_cast<const char*>(&m_prevLargeMarker), sizeof(LargeMarker));
-        m_num_large_markers_wrote += 1;
+        m_largeMarkers.set(m_num_large_markers++, marker.counts, marker.byteIndex);
     }
 
-    // We place a new SmallMarkers for every segment. 
-    AlphaCount16 smallAC;
-    for(size_t j = 0; j < BWT_ALPHABET::size; ++j)
-    {
-        size_t v = m_runningAC.getByIdx(j) - m_prevLargeMarker.counts.getByIdx(j);
-        if(v > smallAC.getMaxValue())
-        {
-            std::cerr << "Error: Number of symbols exceeds the maximum value (" << v << " > " << smallAC.getMaxValue() << ")\n";
-            std::cerr << "RunningAC: " << m_runningAC << "\n";
-            std::cerr << "PrevAC: " << m_prevLargeMarker.counts << "\n";
-            std::cerr << "SmallAC:" << smallAC << "\n";
-            exit(EXIT_FAILURE);
-        }
-        smallAC.setByIdx(j, v);
-    }
-    
-    // Construct the small marker
-    SmallMarker smallMarker;
-    smallMarker.byteCount = starting_byte - m_prevLargeMarker.byteIndex;
-    smallMarker.counts = smallAC;        
-    m_prevSmallMarker = smallMarker;
-
-    // write it to disk
-    mp_sm_tmp->write(reinterpret_cast<const char*>(&m_prevSmallMarker), sizeof(SmallMarker));
-    m_num_small_markers_wrote += 1;
+    // We place a new small marker for every segment, relative to the last large marker
+    AlphaCount64 relative = m_runningAC - m_prevLargeMarker.counts;
+    m_smallMarkers.set(m_num_small_markers++, relative, starting_byte - m_prevLargeMarker.byteIndex);
 }
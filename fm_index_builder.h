@@ -5,13 +5,15 @@
 //-----------------------------------------------
 //
 // FMIndexBuilder - Construct an FM-Index from
-// an SGA BWT file
+// an SGA BWT file. The encoded string and the
+// markers are built in memory and handed to
+// the FMIndex without being copied.
 //
 #ifndef FM_INDEX_BUILDER_H
 #define FM_INDEX_BUILDER_H
 
 #include <deque>
-#include <fstream>
+#include <vector>
 #include "alphabet.h"
 #include "fm_markers.h"
 #include "huffman_tree_codec.h"
@@ -23,14 +25,13 @@ class FMIndexBuilder
         FMIndexBuilder(const std::string& bwt_filename,
                        size_t small_sample_rate,
                        size_t large_sample_rate);
-        ~FMIndexBuilder();
         
         // Get the number of bytes in the compressed string
         size_t getNumStringBytes() const { return m_str_bytes; }
 
         // Get the number of markers
-        size_t getNumSmallMarkers() const { return m_num_small_markers_wrote; }
-        size_t getNumLargeMarkers() const { return m_num_large_markers_wrote; }
+        size_t getNumSmallMarkers() const { return m_smallMarkers.size(); }
+        size_t getNumLargeMarkers() const { return m_largeMarkers.size(); }
 
         size_t getNumStrings() const { return m_strings; }
         size_t getNumSymbols() const { return m_str_symbols; }
@@ -42,15 +43,21 @@ class FMIndexBuilder
         // a table to map from huffman symbols to bwt symbols
         PackedTableDecoder getDecoder() const { return m_decoder; }
 
-        // Get the filenames that the result is stored in
-        std::string getStringFilename() const;
-        std::string getSmallMarkerFilename() const;
-        std::string getLargeMarkerFilename() const;
+        // Transfer the constructed data to the caller by swapping it
+        // into the provided vectors. The builder is left holding
+        // whatever the vectors contained before the call.
+        void swapString(std::vector<uint8_t>& out) { m_string.swap(out); }
+        void swapSmallMarkers(PackedMarkerVector& out) { m_smallMarkers.swap(out); }
+        void swapLargeMarkers(PackedMarkerVector& out) { m_largeMarkers.swap(out); }
+        void swapReverseBytes(PackedMarkerVector& out) { m_reverseBytes.swap(out); }
+        void swapHalfBlockSymbols(std::vector<uint8_t>& out) { m_halfBlockSymbols.swap(out); }
  
     private:
         void build(const std::string& filename);
 
         void buildSegment(HuffmanTreeCodec<char>& encoder, const std::deque<char>& buffer);
+        size_t encodeSegment(HuffmanTreeCodec<char>& encoder, const std::deque<char>& buffer);
+        void setHalfBlockSymbols(const std::deque<char>& buffer, size_t begin, size_t end, size_t half);
         void buildMarkers();
     
         // the decoding table for the huffman tree we constructed
@@ -76,17 +83,29 @@ class FMIndexBuilder
         // A running count of the number of ACGT$ written
         AlphaCount64 m_runningAC;
 
-        // The last large/small marker that were written out
-        SmallMarker m_prevSmallMarker;
+        // The last large marker that was written out
         LargeMarker m_prevLargeMarker;
 
-        size_t m_num_small_markers_wrote;
-        size_t m_num_large_markers_wrote;
+        // The output of the builder. The encoded string is padded with
+        // zeros so the decoder can read ahead past the last symbol.
+        std::vector<uint8_t> m_string;
+        PackedMarkerVector m_smallMarkers;
+        PackedMarkerVector m_largeMarkers;
 
-        // temporary output files
-        std::ofstream* mp_str_tmp;
-        std::ofstream* mp_sm_tmp;
-        std::ofstream* mp_lm_tmp;
+        // The byte length of the reversed half of each full block,
+        // stored in the offset field of an otherwise empty marker
+        PackedMarkerVector m_reverseBytes;
+
+        // A bit for each symbol present in each half of each block,
+        // indexed by the symbol's rank in the bwt alphabet
+        std::vector<uint8_t> m_halfBlockSymbols;
+
+        // the number of markers placed so far
+        size_t m_num_small_markers;
+        size_t m_num_large_markers;
+
+        // scratch space to encode a single segment into
+        std::vector<uint8_t> m_segment;
 };
 
 #endif
@@ -0,0 +1,196 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// FMIndexFile - the single-file on-disk format for
+// a constructed FM-index.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <fstream>
+#include "fm_index_file.h"
+
+// Round n up to the next multiple of the section alignment
+static size_t alignSection(size_t n)
+{
+    return (n + FMINDEX_FILE_ALIGNMENT - 1) / FMINDEX_FILE_ALIGNMENT * FMINDEX_FILE_ALIGNMENT;
+}
+
+//
+void FMIndexFileWriter::addSection(uint32_t id, const void* data, size_t bytes)
+{
+    FMIndexSectionEntry entry;
+    entry.id = id;
+    entry.reserved = 0;
+    entry.offset = 0;
+    entry.bytes = bytes;
+    m_entries.push_back(entry);
+    m_data.push_back(data);
+}
+
+//
+void FMIndexFileWriter::write(const std::string& filename) const
+{
+    // Lay out the sections after the header and section table
+    std::vector<FMIndexSectionEntry> entries = m_entries;
+    size_t offset = alignSection(sizeof(FMIndexFileHeader) +
+                                 entries.size() * sizeof(FMIndexSectionEntry));
+    for(size_t i = 0; i < entries.size(); ++i)
+    {
+        entries[i].offset = offset;
+        offset = alignSection(offset + entries[i].bytes);
+    }
+
+    std::ofstream writer(filename.c_str(), std::ios::binary);
+    if(!writer.is_open())
+    {
+        std::cerr << "Error: could not open " << filename << " for write\n";
+        exit(EXIT_FAILURE);
+    }
+
+    FMIndexFileHeader header;
+    header.magic = FMINDEX_FILE_MAGIC;
+    header.version = FMINDEX_FILE_VERSION;
+    header.num_sections = entries.size();
+    writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if(!entries.empty())
+        writer.write(reinterpret_cast<const char*>(&entries[0]), entries.size() * sizeof(FMIndexSectionEntry));
+
+    // Write each section, padding with zeros up to its offset
+    std::vector<char> zeros(FMINDEX_FILE_ALIGNMENT, 0);
+    size_t written = sizeof(header) + entries.size() * sizeof(FMIndexSectionEntry);
+    for(size_t i = 0; i <= entries.size(); ++i)
+    {
+        size_t target = i < entries.size() ? entries[i].offset : offset;
+        assert(target - written < FMINDEX_FILE_ALIGNMENT);
+        writer.write(&zeros[0], target - written);
+        written = target;
+
+        if(i < entries.size())
+        {
+            writer.write(reinterpret_cast<const char*>(m_data[i]), entries[i].bytes);
+            written += entries[i].bytes;
+        }
+    }
+
+    if(!writer.good())
+    {
+        std::cerr << "Error: failed to write index file " << filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+FMIndexFileReader::FMIndexFileReader(const std::string& filename) : m_filename(filename),
+                                                                    mp_base(NULL),
+                                                                    m_length(0),
+                                                                    mp_entries(NULL),
+                                                                    m_numSections(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        std::cerr << "Error: could not open " << filename << " for read\n";
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FMIndexFileHeader))
+    {
+        std::cerr << "Error: " << filename << " is not a valid index file\n";
+        exit(EXIT_FAILURE);
+    }
+    m_length = st.st_size;
+
+    void* p = mmap(NULL, m_length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(p == MAP_FAILED)
+    {
+        std::cerr << "Error: could not map " << filename << " into memory\n";
+        exit(EXIT_FAILURE);
+    }
+    mp_base = static_cast<const uint8_t*>(p);
+
+    // Validate the header
+    const FMIndexFileHeader* p_header = reinterpret_cast<const FMIndexFileHeader*>(mp_base);
+    if(p_header->magic != FMINDEX_FILE_MAGIC)
+    {
+        std::cerr << "Error: " << filename << " is not a valid index file\n";
+        exit(EXIT_FAILURE);
+    }
+
+    if(p_header->version != FMINDEX_FILE_VERSION)
+    {
+        std::cerr << "Error: " << filename << " has index format version " << p_header->version
+                  << " but version " << FMINDEX_FILE_VERSION << " is required. Please rebuild the index.\n";
+        exit(EXIT_FAILURE);
+    }
+
+    m_numSections = p_header->num_sections;
+    mp_entries = reinterpret_cast<const FMIndexSectionEntry*>(mp_base + sizeof(FMIndexFileHeader));
+    if(sizeof(FMIndexFileHeader) + m_numSections * sizeof(FMIndexSectionEntry) > m_length)
+    {
+        std::cerr << "Error: index file " << filename << " is truncated\n";
+        exit(EXIT_FAILURE);
+    }
+
+    for(size_t i = 0; i < m_numSections; ++i)
+    {
+        if(mp_entries[i].offset + mp_entries[i].bytes > m_length)
+        {
+            std::cerr << "Error: index file " << filename << " is truncated\n";
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+//
+FMIndexFileReader::~FMIndexFileReader()
+{
+    munmap(const_cast<uint8_t*>(mp_base), m_length);
+}
+
+//
+bool FMIndexFileReader::isIndexFile(const std::string& filename)
+{
+    std::ifstream reader(filename.c_str(), std::ios::binary);
+    uint64_t magic = 0;
+    reader.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    return reader.good() && magic == FMINDEX_FILE_MAGIC;
+}
+
+//
+const void* FMIndexFileReader::getSection(uint32_t id, size_t& bytes) const
+{
+    for(size_t i = 0; i < m_numSections; ++i)
+    {
+        if(mp_entries[i].id == id)
+        {
+            bytes = mp_entries[i].bytes;
+            return mp_base + mp_entries[i].offset;
+        }
+    }
+    bytes = 0;
+    return NULL;
+}
+
+//
+const void* FMIndexFileReader::getRequiredSection(uint32_t id, size_t& bytes) const
+{
+    const void* p = getSection(id, bytes);
+    if(p == NULL)
+    {
+        std::cerr << "Error: index file " << m_filename << " is missing section " << id << "\n";
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
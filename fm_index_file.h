@@ -0,0 +1,130 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// FMIndexFile - the single-file on-disk format for
+// a constructed FM-index. The file is a fixed header
+// followed by a table of sections. Every section
+// starts on a 64-byte boundary so the file can be
+// memory-mapped and its contents used in place.
+//
+#ifndef FM_INDEX_FILE_H
+#define FM_INDEX_FILE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// "DBGFMIDX" in little-endian byte order
+const uint64_t FMINDEX_FILE_MAGIC = 0x5844494d46474244ULL;
+
+// Incremented whenever the layout of a section changes
+const uint32_t FMINDEX_FILE_VERSION = 5;
+
+// Alignment of every section within the file
+const size_t FMINDEX_FILE_ALIGNMENT = 64;
+
+// Identifiers for the sections of the file
+enum FMIndexSectionID
+{
+    FMS_INFO = 1,
+    FMS_DECODER,
+    FMS_STRING,
+    FMS_SMALL_MARKERS,
+    FMS_LARGE_MARKERS,
+    FMS_SUPERBLOCK_INFO,
+    FMS_SUPERBLOCKS,
+    FMS_SMALL_MARKER_INFO,
+    FMS_LARGE_MARKER_INFO,
+    FMS_TWO_BIT_INFO,
+    FMS_TWO_BIT_BLOCKS,
+    FMS_TWO_BIT_DOLLARS,
+    FMS_RUN_LENGTH_INFO,
+    FMS_RUN_LENGTH_UNITS,
+    FMS_RUN_LENGTH_POSITIONS,
+    FMS_RUN_LENGTH_LOOKUP,
+    FMS_RUN_LENGTH_MARKER_INFO,
+    FMS_RUN_LENGTH_MARKERS,
+    FMS_WAVELET_INFO,
+    FMS_WAVELET_LEVEL_0,
+    FMS_WAVELET_LEVEL_1,
+    FMS_WAVELET_LEVEL_2,
+    FMS_REVERSE_BYTES_INFO,
+    FMS_REVERSE_BYTES,
+    FMS_INTERVAL_TABLE_INFO,
+    FMS_INTERVAL_TABLE_LOW,
+    FMS_INTERVAL_TABLE_HIGH,
+    FMS_KMER_FILTER_INFO,
+    FMS_KMER_FILTER_BLOCKS,
+    FMS_HALF_BLOCK_SYMBOLS,
+    FMS_CHECKPOINT_BLOCKS,
+    FMS_CHECKPOINTS
+};
+
+struct FMIndexFileHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t num_sections;
+};
+
+struct FMIndexSectionEntry
+{
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+// Collect sections in memory and write them out as an index file.
+// The writer does not copy the section data so it must remain
+// valid until write() is called.
+class FMIndexFileWriter
+{
+    public:
+        void addSection(uint32_t id, const void* data, size_t bytes);
+        void write(const std::string& filename) const;
+
+    private:
+        std::vector<FMIndexSectionEntry> m_entries;
+        std::vector<const void*> m_data;
+};
+
+// Map an index file into memory read-only and provide
+// pointers to its sections
+class FMIndexFileReader
+{
+    public:
+        FMIndexFileReader(const std::string& filename);
+        ~FMIndexFileReader();
+
+        // Returns true if the file starts with the index magic number
+        static bool isIndexFile(const std::string& filename);
+
+        // Return a pointer to the start of the section and set bytes to its size.
+        // Returns NULL if the file does not contain the section.
+        const void* getSection(uint32_t id, size_t& bytes) const;
+
+        // Return the section as an array of T, exiting if it is missing
+        template<typename T>
+        const T* getArray(uint32_t id, size_t& n) const
+        {
+            size_t bytes = 0;
+            const void* p = getRequiredSection(id, bytes);
+            n = bytes / sizeof(T);
+            return reinterpret_cast<const T*>(p);
+        }
+
+    private:
+        const void* getRequiredSection(uint32_t id, size_t& bytes) const;
+
+        std::string m_filename;
+        const uint8_t* mp_base;
+        size_t m_length;
+        const FMIndexSectionEntry* mp_entries;
+        uint32_t m_numSections;
+};
+
+#endif
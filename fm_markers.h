@@ -62,34 +62,193 @@ struct LargeMarker
 };
 typedef std::vector<LargeMarker> LargeMarkerVector;
 
-// SmallMarker - Small markers contain the counts
-// within an individual block of the BWT. In other words
-// the small marker contains the count for the last D2 symbols
-// 
-struct SmallMarker
+// BlockCheckpoint - An extra marker within a full block of
+// the huffman-coded bwt, placed only in frequently decoded
+// blocks. It records where the second quarter of the block
+// starts in the forward-coded first half and where the third
+// quarter starts in the reversed second half, with the counts
+// of the quarter each skips, so a decode within the block
+// reads at most a quarter of it instead of half.
+//
+struct BlockCheckpoint
 {
-    SmallMarker() : byteCount(0) {}
+    // The number of times each symbol occurs in the first
+    // and in the last quarter of the block
+    uint16_t forwardCounts[BWT_ALPHABET::size];
+    uint16_t reverseCounts[BWT_ALPHABET::size];
 
-    // Calculate the actual position in the uncompressed BWT of this marker
-    // This is the number of symbols preceding this marker
-    inline size_t getCountSum() const
-    {
-        return counts.getSum();
-    }
+    // The bit offset of the first symbol after the skipped quarter,
+    // from the start of the forward and of the reversed half
+    uint16_t forwardBit;
+    uint16_t reverseBit;
+};
 
-    void print() const
-    {
-        for(int i = 0; i < BWT_ALPHABET::size; ++i)
-            std::cout << (int)counts.getByIdx(i) << " ";
-        std::cout << "\n";
-    }
+// PackedMarkerVector - A vector of markers where each
+// field is stored in the minimum number of bits needed
+// for the data being indexed. An entry holds a count for
+// each symbol and a byte offset into the compressed string.
+// The widths are chosen when the vector is initialized
+// from the largest value each field can take.
+//
+// The counts of a marker always sum to the number of
+// symbols it covers, which the caller knows, so the widest
+// count is not stored and is recovered from the others.
+//
+struct PackedMarkerInfo
+{
+    uint64_t num_entries;
+    uint8_t count_bits[BWT_ALPHABET::size];
+    uint8_t offset_bits;
+    uint8_t implicit_idx;
+    uint16_t entry_bits;
+};
 
-    // The number of times each symbol has been seen up to this marker
-    AlphaCount16 counts; 
+class PackedMarkerVector
+{
+    public:
+        PackedMarkerVector() : mp_words(NULL)
+        {
+            memset(&m_info, 0, sizeof(m_info));
+        }
+
+        // Choose the field widths and allocate space for n entries
+        void initialize(size_t n, const AlphaCount64& max_counts, uint64_t max_offset)
+        {
+            m_info.num_entries = n;
+            m_info.implicit_idx = 0;
+            for(size_t i = 0; i < BWT_ALPHABET::size; ++i)
+            {
+                m_info.count_bits[i] = getRequiredBits(max_counts.getByIdx(i));
+                if(m_info.count_bits[i] > m_info.count_bits[m_info.implicit_idx])
+                    m_info.implicit_idx = i;
+            }
+            m_info.offset_bits = getRequiredBits(max_offset);
+
+            size_t bits = m_info.offset_bits;
+            for(size_t i = 0; i < BWT_ALPHABET::size; ++i)
+                bits += i != m_info.implicit_idx ? m_info.count_bits[i] : 0;
+            m_info.entry_bits = bits;
+
+            // One extra word lets a field be read with two unconditional loads
+            m_storage.assign((n * m_info.entry_bits + 63) / 64 + 1, 0);
+            mp_words = &m_storage[0];
+        }
+
+        // Use a vector stored in an index file
+        void map(const PackedMarkerInfo& info, const uint64_t* p_words)
+        {
+            m_info = info;
+            std::vector<uint64_t>().swap(m_storage);
+            mp_words = p_words;
+        }
+
+        // Exchange the contents of two vectors without copying
+        void swap(PackedMarkerVector& other)
+        {
+            bool owner = mp_words == NULL || (!m_storage.empty() && mp_words == &m_storage[0]);
+            bool other_owner = other.mp_words == NULL || (!other.m_storage.empty() && other.mp_words == &other.m_storage[0]);
+            std::swap(m_info, other.m_info);
+            std::swap(mp_words, other.mp_words);
+            m_storage.swap(other.m_storage);
+            if(other_owner)
+                mp_words = m_storage.empty() ? NULL : &m_storage[0];
+            if(owner)
+                other.mp_words = other.m_storage.empty() ? NULL : &other.m_storage[0];
+        }
+
+        // Store the marker at index i. The counts must not exceed
+        // the maximums the vector was initialized with.
+        void set(size_t i, const AlphaCount64& counts, uint64_t offset)
+        {
+            assert(i < m_info.num_entries);
+            uint64_t* p_words = &m_storage[0];
+            size_t bit = i * m_info.entry_bits;
+            for(size_t j = 0; j < BWT_ALPHABET::size; ++j)
+            {
+                if(j == m_info.implicit_idx)
+                    continue;
+                assert(getRequiredBits(counts.getByIdx(j)) <= m_info.count_bits[j]);
+                setBits(p_words, bit, m_info.count_bits[j], counts.getByIdx(j));
+                bit += m_info.count_bits[j];
+            }
+            assert(getRequiredBits(offset) <= m_info.offset_bits);
+            setBits(p_words, bit, m_info.offset_bits, offset);
+        }
+
+        // Read the marker at index i. num_symbols is the number of symbols the
+        // marker covers, which is used to recover the count that is not stored.
+        inline void get(size_t i, size_t num_symbols, AlphaCount64& counts, size_t& offset) const
+        {
+            assert(i < m_info.num_entries);
+            size_t bit = i * m_info.entry_bits;
+            size_t sum = 0;
+            for(size_t j = 0; j < BWT_ALPHABET::size; ++j)
+            {
+                if(j == m_info.implicit_idx)
+                    continue;
+                uint64_t v = getBits(bit, m_info.count_bits[j]);
+                counts.setByIdx(j, v);
+                sum += v;
+                bit += m_info.count_bits[j];
+            }
+            counts.setByIdx(m_info.implicit_idx, num_symbols - sum);
+            offset = getBits(bit, m_info.offset_bits);
+        }
+
+        // Start loading the marker at index i into the cache
+        inline void prefetch(size_t i) const
+        {
+            __builtin_prefetch(mp_words + ((i * m_info.entry_bits) >> 6));
+        }
+
+        inline size_t size() const { return m_info.num_entries; }
+        inline const PackedMarkerInfo& getInfo() const { return m_info; }
+        inline const uint64_t* getWords() const { return mp_words; }
+        inline size_t getNumBytes() const { return getNumWords() * sizeof(uint64_t); }
+        inline size_t getNumWords() const { return m_info.num_entries == 0 ? 0 : (m_info.num_entries * m_info.entry_bits + 63) / 64 + 1; }
+
+        // Return the number of bits needed to store v
+        static uint8_t getRequiredBits(uint64_t v)
+        {
+            uint8_t bits = 0;
+            while(v > 0)
+            {
+                v >>= 1;
+                ++bits;
+            }
+            return bits;
+        }
+
+    private:
+
+        // Read a field of width bits starting at bit
+        inline uint64_t getBits(size_t bit, uint8_t width) const
+        {
+            if(width == 0)
+                return 0;
+            size_t word = bit >> 6;
+            size_t shift = bit & 63;
+            uint64_t v = mp_words[word] >> shift;
+            if(shift + width > 64)
+                v |= mp_words[word + 1] << (64 - shift);
+            return width == 64 ? v : v & ((uint64_t(1) << width) - 1);
+        }
+
+        static void setBits(uint64_t* p_words, size_t bit, uint8_t width, uint64_t v)
+        {
+            for(size_t i = 0; i < width; ++i, ++bit)
+            {
+                if((v >> i) & 1)
+                    p_words[bit >> 6] |= uint64_t(1) << (bit & 63);
+            }
+        }
+
+        PackedMarkerInfo m_info;
 
-    // The number of compressed bytes in this block
-    uint16_t byteCount;
+        // Storage for a vector built in memory. mp_words points into
+        // it, or into an index file if the vector is mapped.
+        std::vector<uint64_t> m_storage;
+        const uint64_t* mp_words;
 };
-typedef std::vector<SmallMarker> SmallMarkerVector;
 
 #endif
@@ -0,0 +1,192 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// IntervalCache - a fixed-size cache of the suffix
+// array intervals of short strings
+//
+#include <string.h>
+#include "interval_cache.h"
+#include "alphabet.h"
+
+// Round n up to a power of two
+static size_t roundUpPow2(size_t n)
+{
+    size_t p = 1;
+    while(p < n)
+        p <<= 1;
+    return p;
+}
+
+// Mix the bits of a key so nearby strings land in different shards
+static inline uint64_t hashKey(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+//
+IntervalCache::IntervalCache(size_t num_entries, size_t num_shards)
+{
+    m_numShards = roundUpPow2(num_shards > 0 ? num_shards : 1);
+    m_shardEntries = roundUpPow2(num_entries / m_numShards);
+    if(m_shardEntries < INTERVAL_CACHE_PROBE)
+        m_shardEntries = INTERVAL_CACHE_PROBE;
+
+    // The probe window of the last slots wraps to the start of the shard
+    m_entries.resize(m_numShards * m_shardEntries);
+    memset(&m_entries[0], 0, m_entries.size() * sizeof(Entry));
+
+    m_shards.resize(m_numShards);
+    for(size_t i = 0; i < m_numShards; ++i)
+    {
+        memset(&m_shards[i], 0, sizeof(Shard));
+        m_shards[i].p_entries = &m_entries[i * m_shardEntries];
+    }
+}
+
+//
+bool IntervalCache::makeKey(const std::string& s, uint64_t& key)
+{
+    if(s.size() > INTERVAL_CACHE_MAX_LENGTH)
+        return false;
+
+    key = 1;
+    for(size_t i = 0; i < s.size(); ++i)
+    {
+        // A, C, G and T have ranks 1 to 4. Every other symbol has rank 0.
+        uint64_t r = BWT_ALPHABET::getRank(s[i]);
+        if(r == 0)
+            return false;
+        key = (key << 2) | (r - 1);
+    }
+    return true;
+}
+
+//
+bool IntervalCache::find(const std::string& s, size_t& lower, size_t& upper)
+{
+    uint64_t key;
+    if(!makeKey(s, key))
+        return false;
+
+    uint64_t hash = hashKey(key);
+    Shard& shard = getShard(hash);
+    size_t slot = getSlot(hash);
+
+    bool found = false;
+    lock(shard);
+    for(size_t i = 0; i < INTERVAL_CACHE_PROBE; ++i)
+    {
+        const Entry& entry = shard.p_entries[(slot + i) & (m_shardEntries - 1)];
+        if(entry.key == key)
+        {
+            lower = entry.lower;
+            upper = entry.upper;
+            found = true;
+            break;
+        }
+    }
+
+    if(found)
+        ++shard.hits;
+    else
+        ++shard.misses;
+    unlock(shard);
+    return found;
+}
+
+//
+void IntervalCache::insert(const std::string& s, size_t lower, size_t upper)
+{
+    uint64_t key;
+    if(!makeKey(s, key))
+        return;
+
+    uint64_t hash = hashKey(key);
+    Shard& shard = getShard(hash);
+    size_t slot = getSlot(hash);
+
+    lock(shard);
+
+    // Use the slot holding the key or the first empty one,
+    // otherwise replace the entry at the start of the window
+    Entry* p_target = &shard.p_entries[slot];
+    for(size_t i = 0; i < INTERVAL_CACHE_PROBE; ++i)
+    {
+        Entry* p_entry = &shard.p_entries[(slot + i) & (m_shardEntries - 1)];
+        if(p_entry->key == key || p_entry->key == 0)
+        {
+            p_target = p_entry;
+            break;
+        }
+    }
+
+    if(p_target->key != key)
+    {
+        if(p_target->key != 0)
+            ++shard.evictions;
+        ++shard.insertions;
+    }
+
+    p_target->key = key;
+    p_target->lower = lower;
+    p_target->upper = upper;
+    unlock(shard);
+}
+
+//
+IntervalCacheStats IntervalCache::getStats() const
+{
+    IntervalCacheStats stats;
+    memset(&stats, 0, sizeof(stats));
+    for(size_t i = 0; i < m_numShards; ++i)
+    {
+        Shard& shard = const_cast<Shard&>(m_shards[i]);
+        lock(shard);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.insertions += shard.insertions;
+        stats.evictions += shard.evictions;
+        unlock(shard);
+    }
+    return stats;
+}
+
+//
+void IntervalCache::resetStats()
+{
+    for(size_t i = 0; i < m_numShards; ++i)
+    {
+        Shard& shard = m_shards[i];
+        lock(shard);
+        shard.hits = 0;
+        shard.misses = 0;
+        shard.insertions = 0;
+        shard.evictions = 0;
+        unlock(shard);
+    }
+}
+
+//
+void IntervalCache::lock(Shard& shard)
+{
+    while(__sync_lock_test_and_set(&shard.lock, 1))
+    {
+        // Wait for the lock to look free before trying to take it again
+        while(shard.lock)
+            ;
+    }
+}
+
+//
+void IntervalCache::unlock(Shard& shard)
+{
+    __sync_lock_release(&shard.lock);
+}
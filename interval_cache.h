@@ -0,0 +1,111 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// IntervalCache - a fixed-size cache of the suffix
+// array intervals of short strings, shared by the
+// threads querying an index.
+//
+// Graph traversals search the same (k-1)-mers again
+// and again, as sibling k-mers share a core and walks
+// return to branch points. A string of up to 31 bases
+// is packed into a 64-bit key, two bits per base below
+// a leading 1 bit, and hashed to one of a number of
+// shards. Each shard is an open-addressed table with
+// a short probe window and its own spinlock, so threads
+// only contend when they use the same shard. When the
+// window is full the entry at the start is replaced.
+//
+#ifndef INTERVAL_CACHE_H
+#define INTERVAL_CACHE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// The longest string that fits in a key
+#define INTERVAL_CACHE_MAX_LENGTH 31
+
+// The number of slots searched for a key
+#define INTERVAL_CACHE_PROBE 4
+
+// Hit and miss counts summed over all shards
+struct IntervalCacheStats
+{
+    size_t hits;
+    size_t misses;
+    size_t insertions;
+    size_t evictions;
+};
+
+class IntervalCache
+{
+    public:
+
+        // Allocate a cache of at least num_entries entries split over
+        // num_shards shards. Both are rounded up to a power of two.
+        IntervalCache(size_t num_entries, size_t num_shards = 64);
+
+        // Look up the interval of s. Returns false if it is not cached
+        // or s cannot be stored in the cache.
+        bool find(const std::string& s, size_t& lower, size_t& upper);
+
+        // Store the interval of s. Strings that are too long or contain
+        // a symbol other than A, C, G or T are ignored.
+        void insert(const std::string& s, size_t lower, size_t upper);
+
+        // Return the counts summed over the shards. Lookups of strings that
+        // cannot be cached are not counted.
+        IntervalCacheStats getStats() const;
+        void resetStats();
+
+        inline size_t getNumEntries() const { return m_numShards * m_shardEntries; }
+        inline size_t getNumBytes() const { return getNumEntries() * sizeof(Entry); }
+
+    private:
+
+        // Keys are never 0 as they start with a 1 bit, so 0 marks an empty slot
+        struct Entry
+        {
+            uint64_t key;
+            uint64_t lower;
+            uint64_t upper;
+        };
+
+        // A shard is padded to a cache line so the locks and counters
+        // of different shards do not share one
+        struct Shard
+        {
+            volatile int lock;
+            size_t hits;
+            size_t misses;
+            size_t insertions;
+            size_t evictions;
+            Entry* p_entries;
+            char padding[64 - sizeof(int) - 4 * sizeof(size_t) - sizeof(Entry*)];
+        };
+
+        // Not copyable
+        IntervalCache(const IntervalCache&);
+        IntervalCache& operator=(const IntervalCache&);
+
+        // Pack s into a key. Returns false if it does not fit.
+        static bool makeKey(const std::string& s, uint64_t& key);
+
+        // Return the shard of a hashed key and the first slot of its probe window
+        inline Shard& getShard(uint64_t hash) { return m_shards[hash & (m_numShards - 1)]; }
+        inline size_t getSlot(uint64_t hash) const { return (hash >> 32) & (m_shardEntries - 1); }
+
+        static void lock(Shard& shard);
+        static void unlock(Shard& shard);
+
+        std::vector<Shard> m_shards;
+        std::vector<Entry> m_entries;
+        size_t m_numShards;
+        size_t m_shardEntries;
+};
+
+#endif
@@ -0,0 +1,68 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// IntervalTable - the suffix array interval of every
+// string of q bases
+//
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "interval_table.h"
+
+//
+IntervalTable::IntervalTable()
+{
+    memset(&m_info, 0, sizeof(m_info));
+}
+
+//
+void IntervalTable::initialize(size_t q, size_t num_symbols)
+{
+    if(q == 0 || q > INTERVAL_TABLE_MAX_Q)
+    {
+        fprintf(stderr, "Error: the interval table size q must be between 1 and %d\n", INTERVAL_TABLE_MAX_Q);
+        exit(EXIT_FAILURE);
+    }
+
+    m_info.q = q;
+    m_info.num_entries = 1ULL << (2 * q);
+    m_info.has_high_bytes = (uint64_t)num_symbols >> 32 != 0;
+
+    // Empty intervals are stored as [1, 1) so the interval returned
+    // by a search has lower > upper, as when it is found by ranks
+    m_buildLow.assign(2 * m_info.num_entries, 1);
+    if(m_info.has_high_bytes)
+        m_buildHigh.assign(2 * m_info.num_entries, 0);
+}
+
+//
+void IntervalTable::set(size_t code, size_t lower, size_t end)
+{
+    assert(code < m_info.num_entries);
+    m_buildLow[2 * code] = (uint32_t)lower;
+    m_buildLow[2 * code + 1] = (uint32_t)end;
+    if(m_info.has_high_bytes)
+    {
+        m_buildHigh[2 * code] = (uint8_t)((uint64_t)lower >> 32);
+        m_buildHigh[2 * code + 1] = (uint8_t)((uint64_t)end >> 32);
+    }
+}
+
+//
+void IntervalTable::finalize()
+{
+    m_low.swap(m_buildLow);
+    m_high.swap(m_buildHigh);
+}
+
+//
+void IntervalTable::map(const IntervalTableInfo& info, const uint32_t* p_low, const uint8_t* p_high)
+{
+    m_info = info;
+    m_low.map(p_low, 2 * info.num_entries);
+    if(p_high != NULL)
+        m_high.map(p_high, 2 * info.num_entries);
+}
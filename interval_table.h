@@ -0,0 +1,113 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// IntervalTable - the suffix array interval of every
+// string of q bases, so a backward search can start
+// at step q instead of narrowing the full range one
+// rank query at a time.
+//
+// The first steps of a search touch markers that are
+// far apart in the bwt, so they are the most likely to
+// miss the cache. A q-mer is numbered by reading its
+// bases as base-4 digits, first base most significant,
+// and its entry holds the half-open interval [lower, end).
+// Each bound is stored in 32 bits, with a high byte per
+// bound kept in a separate array when the bwt has 2^32
+// symbols or more.
+//
+#ifndef INTERVAL_TABLE_H
+#define INTERVAL_TABLE_H
+
+#include "alphabet.h"
+#include "mapped_vector.h"
+
+// The largest q that can be used. The table has 4^q entries.
+#define INTERVAL_TABLE_MAX_Q 15
+
+// The parameters of the table, stored alongside the bounds in an index file
+struct IntervalTableInfo
+{
+    uint64_t q;
+    uint64_t num_entries;
+    uint64_t has_high_bytes;
+};
+
+class IntervalTable
+{
+    public:
+        IntervalTable();
+
+        // Allocate a table for q-mers of a bwt with num_symbols symbols.
+        // Every interval is initially empty.
+        void initialize(size_t q, size_t num_symbols);
+
+        // Set the interval of the q-mer with the given number. Must be called before finalize()
+        void set(size_t code, size_t lower, size_t end);
+
+        // Make the bounds set so far available to find()
+        void finalize();
+
+        // Use bounds stored in an index file. p_high is NULL if they fit in 32 bits.
+        void map(const IntervalTableInfo& info, const uint32_t* p_low, const uint8_t* p_high);
+
+        // Look up the interval of the q bases starting at p. Returns false
+        // if the table is empty or one of the bases is not A, C, G or T.
+        inline bool find(const char* p, size_t& lower, size_t& end) const
+        {
+            if(m_info.q == 0)
+                return false;
+
+            size_t code = 0;
+            for(size_t i = 0; i < m_info.q; ++i)
+            {
+                // A, C, G and T have ranks 1 to 4. Every other symbol has rank 0.
+                size_t r = BWT_ALPHABET::getRank(p[i]);
+                if(r == 0)
+                    return false;
+                code = (code << 2) | (r - 1);
+            }
+            return findCode(code, lower, end);
+        }
+
+        // Look up the interval of the q-mer with the given number, as
+        // returned by PackedKmer::getSuffixCode. Returns false if the table is empty.
+        inline bool findCode(size_t code, size_t& lower, size_t& end) const
+        {
+            if(m_info.q == 0)
+                return false;
+
+            lower = m_low[2 * code];
+            end = m_low[2 * code + 1];
+            if(!m_high.empty())
+            {
+                lower |= (size_t)m_high[2 * code] << 32;
+                end |= (size_t)m_high[2 * code + 1] << 32;
+            }
+            return true;
+        }
+
+        inline size_t getQ() const { return m_info.q; }
+        inline const IntervalTableInfo& getInfo() const { return m_info; }
+        inline const uint32_t* getLow() const { return m_low.ptr(); }
+        inline const uint8_t* getHigh() const { return m_high.ptr(); }
+        inline size_t getLowBytes() const { return m_low.getNumBytes(); }
+        inline size_t getHighBytes() const { return m_high.getNumBytes(); }
+        inline size_t getNumBytes() const { return getLowBytes() + getHighBytes(); }
+
+    private:
+
+        IntervalTableInfo m_info;
+
+        // The bounds of entry i are at 2i and 2i + 1
+        MappedVector<uint32_t> m_low;
+        MappedVector<uint8_t> m_high;
+
+        // The bounds are written here during construction then moved into the vectors above
+        std::vector<uint32_t> m_buildLow;
+        std::vector<uint8_t> m_buildHigh;
+};
+
+#endif
@@ -0,0 +1,88 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// KmerFilter - a blocked Bloom filter of the k-mers
+// of an index for one k
+//
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "kmer_filter.h"
+
+//
+KmerFilter::KmerFilter()
+{
+    memset(&m_info, 0, sizeof(m_info));
+}
+
+//
+void KmerFilter::initialize(size_t k, size_t num_kmers, size_t bits_per_kmer)
+{
+    if(k == 0 || k > PackedKmer::MAX_K)
+    {
+        fprintf(stderr, "Error: the k-mer filter k must be between 1 and %zu\n", PackedKmer::MAX_K);
+        exit(EXIT_FAILURE);
+    }
+
+    if(bits_per_kmer == 0)
+    {
+        fprintf(stderr, "Error: the k-mer filter must have at least one bit per k-mer\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t block_bits = KMER_FILTER_BLOCK_WORDS * 64;
+    m_info.k = k;
+    m_info.num_kmers = num_kmers;
+    m_info.num_blocks = (num_kmers * bits_per_kmer + block_bits - 1) / block_bits;
+    if(m_info.num_blocks == 0)
+        m_info.num_blocks = 1;
+
+    // The false positive rate of a Bloom filter is lowest with ln(2) bits set per bit used
+    m_info.num_hashes = (uint64_t)(bits_per_kmer * log(2.0) + 0.5);
+    if(m_info.num_hashes < 1)
+        m_info.num_hashes = 1;
+    if(m_info.num_hashes > KMER_FILTER_MAX_HASHES)
+        m_info.num_hashes = KMER_FILTER_MAX_HASHES;
+
+    m_buildWords.assign(m_info.num_blocks * KMER_FILTER_BLOCK_WORDS, 0);
+}
+
+//
+void KmerFilter::insert(uint64_t canonical)
+{
+    uint64_t bit_hash;
+    uint64_t* p_block = &m_buildWords[getBlock(canonical, bit_hash) * KMER_FILTER_BLOCK_WORDS];
+    uint32_t bit = (uint32_t)bit_hash;
+    uint32_t step = (uint32_t)(bit_hash >> 32) | 1;
+    for(size_t i = 0; i < m_info.num_hashes; ++i, bit += step)
+        p_block[(bit >> 6) & (KMER_FILTER_BLOCK_WORDS - 1)] |= 1ULL << (bit & 63);
+}
+
+//
+void KmerFilter::finalize()
+{
+    m_words.swap(m_buildWords);
+}
+
+//
+void KmerFilter::map(const KmerFilterInfo& info, const uint64_t* p_words)
+{
+    m_info = info;
+    m_words.map(p_words, info.num_blocks * KMER_FILTER_BLOCK_WORDS);
+}
+
+//
+bool KmerFilter::mayContain(const std::string& s) const
+{
+    if(m_info.k == 0 || s.size() != m_info.k)
+        return true;
+
+    PackedKmer kmer;
+    if(!kmer.assign(s))
+        return true;
+    return test(getCanonical(kmer));
+}
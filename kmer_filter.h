@@ -0,0 +1,135 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// KmerFilter - a blocked Bloom filter of the k-mers
+// of an index for one k, so most queries for k-mers
+// that are not in the graph are answered without a
+// backward search.
+//
+// A k-mer and its reverse-complement are added as
+// one canonical k-mer, the smaller of the two packed
+// values. Each k-mer hashes to a single block of 512
+// bits, one cache line, and sets a number of bits
+// within it. A query reads that one block. The filter
+// has no false negatives, so a k-mer it rejects is not
+// in the index on either strand. A k-mer it accepts
+// may still be absent and must be searched.
+//
+#ifndef KMER_FILTER_H
+#define KMER_FILTER_H
+
+#include <string>
+#include <vector>
+#include "packed_kmer.h"
+#include "mapped_vector.h"
+
+// The number of 64-bit words in a block
+#define KMER_FILTER_BLOCK_WORDS 8
+
+// The most bits set per k-mer
+#define KMER_FILTER_MAX_HASHES 16
+
+// The parameters of the filter, stored alongside the blocks in an index file
+struct KmerFilterInfo
+{
+    uint64_t k;
+    uint64_t num_kmers;
+    uint64_t num_blocks;
+    uint64_t num_hashes;
+};
+
+class KmerFilter
+{
+    public:
+        KmerFilter();
+
+        // Allocate a filter of bits_per_kmer bits for each of num_kmers k-mers.
+        // The number of bits set per k-mer is chosen to minimize false positives.
+        void initialize(size_t k, size_t num_kmers, size_t bits_per_kmer);
+
+        // Add the k-mer with the given canonical value. Must be called before finalize()
+        void insert(uint64_t canonical);
+
+        // Make the k-mers added so far available to the queries
+        void finalize();
+
+        // Use blocks stored in an index file
+        void map(const KmerFilterInfo& info, const uint64_t* p_words);
+
+        // Returns false if the k-mer is certainly not in the index on either strand.
+        // K-mers of another length or with a symbol other than A, C, G or T,
+        // and every k-mer when the filter is empty, return true.
+        inline bool mayContain(const PackedKmer& kmer) const
+        {
+            if(m_info.k == 0 || kmer.size() != m_info.k)
+                return true;
+            return test(getCanonical(kmer));
+        }
+
+        bool mayContain(const std::string& s) const;
+
+        // Return the smaller of the packed k-mer and its reverse-complement
+        static inline uint64_t getCanonical(const PackedKmer& kmer)
+        {
+            uint64_t fwd = kmer.getBits();
+            uint64_t rc = kmer.reverseComplement().getBits();
+            return fwd < rc ? fwd : rc;
+        }
+
+        inline size_t getK() const { return m_info.k; }
+        inline const KmerFilterInfo& getInfo() const { return m_info; }
+        inline const uint64_t* getWords() const { return m_words.ptr(); }
+        inline size_t getNumBytes() const { return m_words.getNumBytes(); }
+
+    private:
+
+        // Return the block of a canonical k-mer and the hash its bits are taken from
+        inline size_t getBlock(uint64_t canonical, uint64_t& bit_hash) const;
+
+        // Returns true if every bit of the canonical k-mer is set
+        inline bool test(uint64_t canonical) const
+        {
+            uint64_t bit_hash;
+            const uint64_t* p_block = m_words.ptr() + getBlock(canonical, bit_hash) * KMER_FILTER_BLOCK_WORDS;
+            uint32_t bit = (uint32_t)bit_hash;
+            uint32_t step = (uint32_t)(bit_hash >> 32) | 1;
+            for(size_t i = 0; i < m_info.num_hashes; ++i, bit += step)
+            {
+                if(!(p_block[(bit >> 6) & (KMER_FILTER_BLOCK_WORDS - 1)] & (1ULL << (bit & 63))))
+                    return false;
+            }
+            return true;
+        }
+
+        KmerFilterInfo m_info;
+        MappedVector<uint64_t> m_words;
+
+        // The blocks are written here during construction then moved into m_words
+        std::vector<uint64_t> m_buildWords;
+};
+
+// Mix the bits of a key
+static inline uint64_t mixKmerBits(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+//
+inline size_t KmerFilter::getBlock(uint64_t canonical, uint64_t& bit_hash) const
+{
+    // The block is chosen by the high bits of one hash, scaled to the
+    // number of blocks, and the bits within it by a second hash
+    uint64_t block_hash = mixKmerBits(canonical);
+    bit_hash = mixKmerBits(canonical ^ 0x9e3779b97f4a7c15ULL);
+    return (size_t)(((unsigned __int128)block_hash * m_info.num_blocks) >> 64);
+}
+
+#endif
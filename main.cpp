@@ -3,7 +3,10 @@
 #include <fstream>
 #include <string>
 #include "fm_index.h"
+#include "fm_index_file.h"
 #include "dbg_query.h"
+#include "query_main.h"
+#include "densify_main.h"
 
 // Return a random string of length n
 std::string getRandomSequence(size_t n)
@@ -17,16 +20,34 @@ std::string getRandomSequence(size_t n)
 
 int main(int argc, char** argv)
 {
-    if(argc != 2)
+    if(argc >= 2 && std::string(argv[1]) == "query")
+        return queryMain(argc - 1, argv + 1);
+    if(argc >= 2 && std::string(argv[1]) == "densify")
+        return densifyMain(argc - 1, argv + 1);
+
+    // --rc marks a bwt built from both strands with bwtdisk-prepare --rc
+    bool strand_symmetric = argc == 3 && std::string(argv[1]) == "--rc";
+    if(argc != 2 && !strand_symmetric)
     {
-        printf("usage: ./dbgfm <reference_prefix>\n");
+        printf("usage: ./dbgfm [--rc] <reference_prefix>\n");
+        printf("       ./dbgfm query [options] <index.dbgfm> [input]\n");
+        printf("       ./dbgfm densify [options] <index.dbgfm> <profile> <out.dbgfm>\n");
         exit(EXIT_FAILURE);
     }
 
     printf("Loading FM-index\n");
-    std::string prefix = argv[1];
+    std::string prefix = argv[argc - 1];
     std::string test_bwt = prefix + ".bwtdisk";
-    FMIndex index(test_bwt, 256);
+    std::string test_index = prefix + ".dbgfm";
+
+    // Build the index from the bwt the first time and save it.
+    // Later runs map the saved index directly.
+    bool has_index = FMIndexFileReader::isIndexFile(test_index);
+    FMIndexParameters params;
+    params.smallSampleRate = 256;
+    params.strandSymmetric = strand_symmetric;
+    params.outFilename = test_index;
+    FMIndex index(has_index ? test_index : test_bwt, params);
 
     // Verify that the FM-index data structures are set correctly
     //index.verify(test_bwt);
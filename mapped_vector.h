@@ -0,0 +1,89 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// MappedVector - a read-only array that either owns
+// its storage or refers to memory owned by someone
+// else (typically a memory-mapped index file)
+//
+#ifndef MAPPED_VECTOR_H
+#define MAPPED_VECTOR_H
+
+#include <vector>
+#include <assert.h>
+#include <stddef.h>
+
+template<typename T>
+class MappedVector
+{
+    public:
+        MappedVector() : mp_data(NULL), m_size(0) {}
+
+        MappedVector(const MappedVector& other) : m_owned(other.m_owned)
+        {
+            if(other.isOwner())
+                adopt();
+            else
+                map(other.mp_data, other.m_size);
+        }
+
+        MappedVector& operator=(const MappedVector& other)
+        {
+            if(this != &other)
+            {
+                m_owned = other.m_owned;
+                if(other.isOwner())
+                    adopt();
+                else
+                    map(other.mp_data, other.m_size);
+            }
+            return *this;
+        }
+
+        // Take ownership of the contents of v without copying.
+        // On return v holds whatever this vector owned before.
+        void swap(std::vector<T>& v)
+        {
+            m_owned.swap(v);
+            adopt();
+        }
+
+        // Refer to n elements of externally-owned memory.
+        // The memory must outlive this object.
+        void map(const T* p, size_t n)
+        {
+            std::vector<T>().swap(m_owned);
+            mp_data = p;
+            m_size = n;
+        }
+
+        inline const T& operator[](size_t i) const
+        {
+            assert(i < m_size);
+            return mp_data[i];
+        }
+
+        inline const T& back() const { assert(m_size > 0); return mp_data[m_size - 1]; }
+        inline const T* ptr() const { return mp_data; }
+        inline size_t size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+        inline size_t getNumBytes() const { return m_size * sizeof(T); }
+
+    private:
+
+        inline bool isOwner() const { return m_owned.empty() ? mp_data == NULL : mp_data == &m_owned[0]; }
+
+        void adopt()
+        {
+            mp_data = m_owned.empty() ? NULL : &m_owned[0];
+            m_size = m_owned.size();
+        }
+
+        std::vector<T> m_owned;
+        const T* mp_data;
+        size_t m_size;
+};
+
+#endif
@@ -0,0 +1,178 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// PackedKmer - a k-mer stored two bits per base in
+// a single integer, so moving to a neighbor or taking
+// the reverse-complement is a few bit operations
+// instead of building a new string.
+//
+// A, C, G and T are stored as 0 to 3, their ranks in
+// the bwt alphabet less one, with the first base in
+// the most significant position. The complement of a
+// base is then its bitwise not, and the last n bases
+// read as a number give the code used by IntervalTable.
+// PackedKmer holds up to 32 bases and LongPackedKmer,
+// which uses the 128-bit integer type of gcc, up to 64.
+//
+#ifndef PACKED_KMER_H
+#define PACKED_KMER_H
+
+#include <string>
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "alphabet.h"
+
+// Reverse the order of the 2-bit fields of a word
+inline uint64_t reversePackedBases(uint64_t x)
+{
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return __builtin_bswap64(x);
+}
+
+inline unsigned __int128 reversePackedBases(unsigned __int128 x)
+{
+    unsigned __int128 lo = reversePackedBases((uint64_t)x);
+    unsigned __int128 hi = reversePackedBases((uint64_t)(x >> 64));
+    return (lo << 64) | hi;
+}
+
+template<typename Word>
+class BasicPackedKmer
+{
+    public:
+
+        // The most bases a k-mer can hold
+        static const size_t MAX_K = sizeof(Word) * 4;
+
+        BasicPackedKmer() : m_bits(0), m_k(0) {}
+
+        // Pack the k bases starting at s. Returns false, leaving the k-mer
+        // unchanged, if k is too large or one of the bases is not A, C, G or T.
+        bool assign(const char* s, size_t k)
+        {
+            if(k > MAX_K)
+                return false;
+
+            Word bits = 0;
+            for(size_t i = 0; i < k; ++i)
+            {
+                int r = BWT_ALPHABET::getRank(s[i]);
+                if(r == 0)
+                    return false;
+                bits = (bits << 2) | (Word)(r - 1);
+            }
+            m_bits = bits;
+            m_k = k;
+            return true;
+        }
+
+        inline bool assign(const std::string& s) { return assign(s.data(), s.size()); }
+
+        inline size_t size() const { return m_k; }
+        inline bool empty() const { return m_k == 0; }
+        inline Word getBits() const { return m_bits; }
+
+        // Return the base at position i, as 0 to 3 or as a character
+        inline int getCode(size_t i) const
+        {
+            assert(i < m_k);
+            return (int)(m_bits >> (2 * (m_k - 1 - i))) & 3;
+        }
+
+        inline char getBase(size_t i) const { return "ACGT"[getCode(i)]; }
+
+        // Return the number formed by the last n bases
+        inline size_t getSuffixCode(size_t n) const
+        {
+            assert(n <= m_k && n <= 32);
+            return (size_t)(m_bits & getMask(n));
+        }
+
+        // Drop the first base and append b, making the k-mer Xb of aX
+        inline void shiftInLast(char b)
+        {
+            m_bits = ((m_bits << 2) | toCode(b)) & getMask(m_k);
+        }
+
+        // Drop the last base and prepend b, making the k-mer bY of Ya
+        inline void shiftInFirst(char b)
+        {
+            assert(m_k > 0);
+            m_bits = (m_bits >> 2) | (toCode(b) << (2 * (m_k - 1)));
+        }
+
+        // Return the (k-1)-mer without the first, or the last, base
+        inline BasicPackedKmer dropFirst() const
+        {
+            assert(m_k > 0);
+            return BasicPackedKmer(m_bits & getMask(m_k - 1), m_k - 1);
+        }
+
+        inline BasicPackedKmer dropLast() const
+        {
+            assert(m_k > 0);
+            return BasicPackedKmer(m_bits >> 2, m_k - 1);
+        }
+
+        // Return the reverse-complement. Reversing the whole word leaves the
+        // k-mer in the top 2k bits, which are shifted down.
+        inline BasicPackedKmer reverseComplement() const
+        {
+            if(m_k == 0)
+                return *this;
+            Word rc = reversePackedBases((Word)~m_bits);
+            return BasicPackedKmer(rc >> (8 * sizeof(Word) - 2 * m_k), m_k);
+        }
+
+        // Write the bases to out, which must have room for size() characters
+        void toChars(char* out) const
+        {
+            for(size_t i = 0; i < m_k; ++i)
+                out[i] = getBase(i);
+        }
+
+        std::string toString() const
+        {
+            std::string out(m_k, 'A');
+            for(size_t i = 0; i < m_k; ++i)
+                out[i] = getBase(i);
+            return out;
+        }
+
+        inline bool operator==(const BasicPackedKmer& other) const
+        {
+            return m_k == other.m_k && m_bits == other.m_bits;
+        }
+
+        inline bool operator!=(const BasicPackedKmer& other) const { return !(*this == other); }
+
+    private:
+
+        BasicPackedKmer(Word bits, size_t k) : m_bits(bits), m_k(k) {}
+
+        // Return a mask of the low 2n bits
+        static inline Word getMask(size_t n)
+        {
+            return n >= MAX_K ? ~(Word)0 : ((Word)1 << (2 * n)) - 1;
+        }
+
+        static inline Word toCode(char b)
+        {
+            int r = BWT_ALPHABET::getRank(b);
+            assert(r > 0 && "Unknown base!");
+            return (Word)(r - 1);
+        }
+
+        Word m_bits;
+        size_t m_k;
+};
+
+typedef BasicPackedKmer<uint64_t> PackedKmer;
+typedef BasicPackedKmer<unsigned __int128> LongPackedKmer;
+
+#endif
@@ -20,6 +20,21 @@
 #define UNPACK_SYMBOL(in) (in) >> PACKED_DECODE_SHIFT
 #define UNPACK_BITS(in) (in) & PACKED_BITS_MASK
 
+// Multi-symbol decode table entries. Each entry describes all the
+// codes that fit completely in a MULTI_DECODE_BITS window:
+//   bits 0-3: number of symbols, bits 4-7: number of bits they use,
+//   bits 8-27: a 4-bit count for each symbol, bits 28-30: the last symbol
+#define MULTI_DECODE_BITS 12
+#define MULTI_DECODE_TYPE uint32_t
+#define MULTI_COUNT_SHIFT 8
+#define MULTI_COUNT_BITS 4
+#define MULTI_LAST_SHIFT 28
+
+#define UNPACK_MULTI_SYMBOLS(in) ((in) & 15)
+#define UNPACK_MULTI_BITS(in) (((in) >> 4) & 15)
+#define UNPACK_MULTI_COUNT(in, rank) (((in) >> (MULTI_COUNT_SHIFT + MULTI_COUNT_BITS * (rank))) & 15)
+#define UNPACK_MULTI_LAST(in) (((in) >> MULTI_LAST_SHIFT) & 7)
+
 // Packed table decoder for characters
 class PackedTableDecoder
 {
@@ -33,6 +48,15 @@ class PackedTableDecoder
             m_decodeTable.reserve(max+1);
             for(size_t i = 0; i <= max; ++i)
                 m_decodeTable.push_back(pack(tree.decodeSymbol(i), tree.decodeBits(i)));
+            initializeMultiTable();
+        }
+
+        // Initialize from a previously packed table, for example one read from an index file
+        void initialize(const PACKED_DECODE_TYPE* table, size_t n, int readLen)
+        {
+            m_readLen = readLen;
+            m_decodeTable.assign(table, table + n);
+            initializeMultiTable();
         }
 
         inline int getCodeReadLength() const
@@ -52,8 +76,52 @@ class PackedTableDecoder
             return &m_decodeTable;
         }
 
+        // Return a pointer to the multi-symbol table, indexed by the next MULTI_DECODE_BITS bits
+        inline const MULTI_DECODE_TYPE* getMultiTable() const
+        {
+            return &m_multiTable[0];
+        }
+
         std::vector<PACKED_DECODE_TYPE> m_decodeTable;
+        std::vector<MULTI_DECODE_TYPE> m_multiTable;
         int m_readLen;
+
+    private:
+
+        // Build the multi-symbol table from the single-symbol table
+        void initializeMultiTable()
+        {
+            // Every window must contain at least one code and the counts must fit in their lanes
+            assert(m_readLen <= MULTI_DECODE_BITS);
+            assert(MULTI_DECODE_BITS < (1 << MULTI_COUNT_BITS));
+
+            PACKED_DECODE_TYPE mask = (1 << m_readLen) - 1;
+            m_multiTable.resize(1 << MULTI_DECODE_BITS);
+            for(size_t v = 0; v < m_multiTable.size(); ++v)
+            {
+                // Pad the window with zeros so a code can be looked up at any offset.
+                // Only codes that end within the window are used.
+                size_t padded = v << m_readLen;
+                MULTI_DECODE_TYPE entry = 0;
+                int num_symbols = 0;
+                int bits = 0;
+                while(true)
+                {
+                    PACKED_DECODE_TYPE code = (padded >> (MULTI_DECODE_BITS - bits)) & mask;
+                    PACKED_DECODE_TYPE packed = m_decodeTable[code];
+                    int code_bits = UNPACK_BITS(packed);
+                    if(bits + code_bits > MULTI_DECODE_BITS)
+                        break;
+
+                    int rank = UNPACK_SYMBOL(packed);
+                    entry += 1 << (MULTI_COUNT_SHIFT + MULTI_COUNT_BITS * rank);
+                    entry = (entry & ~(7 << MULTI_LAST_SHIFT)) | (rank << MULTI_LAST_SHIFT);
+                    bits += code_bits;
+                    num_symbols += 1;
+                }
+                m_multiTable[v] = entry | (bits << 4) | num_symbols;
+            }
+        }
 };
 
 #endif
@@ -0,0 +1,467 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// query_main - the dbgfm query subcommand
+//
+// The input is read in batches. Each batch is sorted
+// to remove repeated queries, then the threads take
+// chunks of the distinct queries until all are
+// answered, and the answers are written in the order
+// of the input. The main thread reads the input and
+// writes the output between batches and answers
+// queries like the other threads during a batch.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "query_main.h"
+#include "fm_index.h"
+#include "fm_index_file.h"
+#include "dbg_query.h"
+
+// The number of distinct queries a thread takes at a time
+#define QUERY_CHUNK_SIZE 256
+
+static const char* QUERY_USAGE =
+"usage: dbgfm query [-t threads] [-k k] [-b batch_size] [-c cache_mb] [-p profile] <index.dbgfm> [input]\n"
+"\n"
+"Answer de Bruijn graph queries for the k-mers or sequences in input, or\n"
+"stdin if input is - or not given. Each line is a query, or with FASTA\n"
+"input each record. With -k k every k-mer of each query is queried instead.\n"
+"\n"
+"  -t threads     number of threads answering queries (default 1)\n"
+"  -k k           query every k-mer of the input sequences\n"
+"  -b batch_size  number of queries read at a time (default 100000)\n"
+"  -c cache_mb    keep up to cache_mb megabytes of decoded blocks of a\n"
+"                 huffman-coded index and report the hit rate (default 0)\n"
+"  -p profile     count the decodes of each block of a huffman-coded index\n"
+"                 and write them to profile, for use with dbgfm densify\n"
+"\n"
+"One line is written per query, in input order, with the tab-separated fields\n"
+"query, is_vertex, count, rc_count, prefix_neighbors and suffix_neighbors.\n"
+"An empty neighbor set is written as -.\n";
+
+// The answers to one query
+struct QueryResult
+{
+    size_t count;
+    size_t rc_count;
+    std::string prefix_neighbors;
+    std::string suffix_neighbors;
+};
+
+// The state shared by the threads answering a batch
+struct QueryPool
+{
+    const FMIndex* p_index;
+    size_t num_threads;
+
+    // The threads wait at start_barrier until a batch is ready
+    // or done is set, and at end_barrier when it is answered
+    pthread_barrier_t start_barrier;
+    pthread_barrier_t end_barrier;
+    bool done;
+
+    // The distinct queries of the batch, their answers and the next query to take
+    const std::vector<std::string>* p_queries;
+    std::vector<QueryResult>* p_results;
+    volatile size_t next_query;
+};
+
+//
+// QueryReader - splits the input into queries
+//
+class QueryReader
+{
+    public:
+        QueryReader(std::istream* p_in, size_t k) : mp_in(p_in),
+                                                    m_k(k),
+                                                    m_fasta(false),
+                                                    m_hasRecord(false),
+                                                    m_pos(0) {}
+
+        // Append up to n queries to batch
+        void readBatch(size_t n, std::vector<std::string>& batch);
+
+    private:
+
+        // Read the next line that is not empty, in upper case.
+        // Returns false at the end of the input.
+        bool readLine(std::string& line);
+
+        std::istream* mp_in;
+        size_t m_k;
+
+        // Set once a header has been read. The lines of a
+        // record are then joined, otherwise each is separate.
+        bool m_fasta;
+        bool m_hasRecord;
+        std::string m_record;
+
+        // The sequence being split into k-mers and the start of the next one
+        std::string m_seq;
+        size_t m_pos;
+};
+
+//
+bool QueryReader::readLine(std::string& line)
+{
+    while(getline(*mp_in, line))
+    {
+        if(!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        if(line.empty())
+            continue;
+        for(size_t i = 0; i < line.size(); ++i)
+            line[i] = toupper(line[i]);
+        return true;
+    }
+    return false;
+}
+
+//
+void QueryReader::readBatch(size_t n, std::vector<std::string>& batch)
+{
+    std::string line;
+    while(batch.size() < n)
+    {
+        if(m_k > 0)
+        {
+            // Take the k-mers of the current sequence, then extend it with the next line.
+            // The k-mers of a record span its lines.
+            if(m_pos + m_k <= m_seq.size())
+            {
+                batch.push_back(m_seq.substr(m_pos++, m_k));
+                continue;
+            }
+
+            if(!readLine(line))
+                return;
+
+            if(line[0] == '>')
+            {
+                m_fasta = true;
+                m_seq.clear();
+            }
+            else if(m_fasta)
+            {
+                m_seq = m_seq.substr(m_pos) + line;
+            }
+            else
+            {
+                m_seq = line;
+            }
+            m_pos = 0;
+        }
+        else
+        {
+            // Each line is a query, or each record when the input is FASTA
+            bool has_line = readLine(line);
+            if(!has_line || line[0] == '>')
+            {
+                if(m_hasRecord && !m_record.empty())
+                    batch.push_back(m_record);
+                m_record.clear();
+                m_hasRecord = has_line;
+                m_fasta = m_fasta || has_line;
+                if(!has_line)
+                    return;
+            }
+            else if(m_fasta)
+            {
+                m_record.append(line);
+            }
+            else
+            {
+                batch.push_back(line);
+            }
+        }
+    }
+}
+
+// Answer the queries in [begin, end)
+static void answerQueries(const FMIndex* p_index, const std::vector<std::string>& queries,
+                          size_t begin, size_t end, std::vector<QueryResult>& results)
+{
+    // Only strings of A, C, G and T are searched. Any other query is not in the graph,
+    // nor is a k-mer rejected by the index's k-mer filter.
+    const KmerFilter& filter = p_index->getKmerFilter();
+    std::vector<std::string> kmers;
+    std::vector<size_t> kmer_idx;
+    for(size_t i = begin; i < end; ++i)
+    {
+        QueryResult& result = results[i];
+        result.count = 0;
+        result.rc_count = 0;
+        result.prefix_neighbors.clear();
+        result.suffix_neighbors.clear();
+        if(queries[i].find_first_not_of("ACGT") == std::string::npos && filter.mayContain(queries[i]))
+        {
+            kmers.push_back(queries[i]);
+            kmer_idx.push_back(i);
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t> > intervals;
+    p_index->findIntervals(kmers, intervals);
+    for(size_t i = 0; i < kmers.size(); ++i)
+        results[kmer_idx[i]].count = intervals[i].second + 1 - intervals[i].first;
+
+    // A k-mer and its reverse-complement occur equally often when both strands are indexed
+    if(p_index->isStrandSymmetric())
+    {
+        for(size_t i = 0; i < kmers.size(); ++i)
+            results[kmer_idx[i]].rc_count = results[kmer_idx[i]].count;
+    }
+    else
+    {
+        std::vector<std::string> rc_kmers(kmers.size());
+        for(size_t i = 0; i < kmers.size(); ++i)
+            rc_kmers[i] = reverseComplement(kmers[i]);
+        p_index->findIntervals(rc_kmers, intervals);
+        for(size_t i = 0; i < kmers.size(); ++i)
+            results[kmer_idx[i]].rc_count = intervals[i].second + 1 - intervals[i].first;
+    }
+
+    // Neighbors are only found for vertices. A single base has no (k-1)-mer to extend.
+    std::vector<std::string> vertices;
+    std::vector<size_t> vertex_idx;
+    for(size_t i = 0; i < kmers.size(); ++i)
+    {
+        const QueryResult& result = results[kmer_idx[i]];
+        if(kmers[i].size() > 1 && result.count + result.rc_count > 0)
+        {
+            vertices.push_back(kmers[i]);
+            vertex_idx.push_back(kmer_idx[i]);
+        }
+    }
+
+    std::vector<std::string> neighbors;
+    DBGQuery::getPrefixNeighborsBatch(p_index, vertices, neighbors);
+    for(size_t i = 0; i < vertices.size(); ++i)
+        results[vertex_idx[i]].prefix_neighbors.swap(neighbors[i]);
+
+    DBGQuery::getSuffixNeighborsBatch(p_index, vertices, neighbors);
+    for(size_t i = 0; i < vertices.size(); ++i)
+        results[vertex_idx[i]].suffix_neighbors.swap(neighbors[i]);
+}
+
+// Take chunks of the current batch until every query has been taken
+static void answerBatch(QueryPool* p_pool)
+{
+    size_t n = p_pool->p_queries->size();
+    while(true)
+    {
+        size_t begin = __sync_fetch_and_add(&p_pool->next_query, QUERY_CHUNK_SIZE);
+        if(begin >= n)
+            return;
+        size_t end = std::min(begin + QUERY_CHUNK_SIZE, n);
+        answerQueries(p_pool->p_index, *p_pool->p_queries, begin, end, *p_pool->p_results);
+    }
+}
+
+// The loop run by the threads other than the main thread
+static void* queryWorker(void* p_arg)
+{
+    QueryPool* p_pool = static_cast<QueryPool*>(p_arg);
+    while(true)
+    {
+        pthread_barrier_wait(&p_pool->start_barrier);
+        if(p_pool->done)
+            return NULL;
+        answerBatch(p_pool);
+        pthread_barrier_wait(&p_pool->end_barrier);
+    }
+}
+
+// Append the answers for a query to out
+static void writeResult(const std::string& query, const QueryResult& result, std::string& out)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "\t%d\t%zu\t%zu\t",
+             result.count + result.rc_count > 0, result.count, result.rc_count);
+    out.append(query);
+    out.append(buffer);
+    out.append(result.prefix_neighbors.empty() ? "-" : result.prefix_neighbors);
+    out.append(1, '\t');
+    out.append(result.suffix_neighbors.empty() ? "-" : result.suffix_neighbors);
+    out.append(1, '\n');
+}
+
+// Return the time in seconds
+static double getTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+//
+int queryMain(int argc, char** argv)
+{
+    size_t num_threads = 1;
+    size_t k = 0;
+    size_t batch_size = 100000;
+    size_t cache_mb = 0;
+    std::string profile_filename;
+
+    int c;
+    while((c = getopt(argc, argv, "t:k:b:c:p:h")) != -1)
+    {
+        switch(c)
+        {
+            case 't': num_threads = strtoul(optarg, NULL, 10); break;
+            case 'k': k = strtoul(optarg, NULL, 10); break;
+            case 'b': batch_size = strtoul(optarg, NULL, 10); break;
+            case 'c': cache_mb = strtoul(optarg, NULL, 10); break;
+            case 'p': profile_filename = optarg; break;
+            case 'h': printf("%s", QUERY_USAGE); return EXIT_SUCCESS;
+            default: fprintf(stderr, "%s", QUERY_USAGE); return EXIT_FAILURE;
+        }
+    }
+
+    if(argc - optind < 1 || argc - optind > 2 || num_threads == 0 || batch_size == 0)
+    {
+        fprintf(stderr, "%s", QUERY_USAGE);
+        return EXIT_FAILURE;
+    }
+
+    std::string index_filename = argv[optind];
+    std::string input_filename = argc - optind == 2 ? argv[optind + 1] : "-";
+    if(!FMIndexFileReader::isIndexFile(index_filename))
+    {
+        fprintf(stderr, "Error: %s is not an index file\n", index_filename.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream in_file;
+    std::istream* p_in = &std::cin;
+    if(input_filename != "-")
+    {
+        in_file.open(input_filename.c_str());
+        if(!in_file.good())
+        {
+            fprintf(stderr, "Error: could not read %s\n", input_filename.c_str());
+            return EXIT_FAILURE;
+        }
+        p_in = &in_file;
+    }
+
+    // The index summary would be mixed into the output
+    FMIndexParameters params;
+    params.verbose = false;
+    FMIndex index(index_filename, params);
+
+    BlockCache* p_block_cache = NULL;
+    if(cache_mb > 0)
+    {
+        p_block_cache = new BlockCache(cache_mb << 20);
+        index.setBlockCache(p_block_cache);
+    }
+
+    BlockProfile profile;
+    if(!profile_filename.empty())
+        index.setBlockProfile(&profile);
+
+    QueryPool pool;
+    pool.p_index = &index;
+    pool.num_threads = num_threads;
+    pool.done = false;
+    pool.p_queries = NULL;
+    pool.p_results = NULL;
+    pool.next_query = 0;
+    pthread_barrier_init(&pool.start_barrier, NULL, num_threads);
+    pthread_barrier_init(&pool.end_barrier, NULL, num_threads);
+
+    std::vector<pthread_t> threads(num_threads - 1);
+    for(size_t i = 0; i < threads.size(); ++i)
+    {
+        if(pthread_create(&threads[i], NULL, queryWorker, &pool) != 0)
+        {
+            fprintf(stderr, "Error: could not create query thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    double start_time = getTime();
+    size_t num_queries = 0;
+    size_t num_distinct = 0;
+
+    QueryReader reader(p_in, k);
+    std::vector<std::string> batch;
+    std::vector<std::string> distinct;
+    std::vector<QueryResult> results;
+    std::string out;
+    while(true)
+    {
+        batch.clear();
+        reader.readBatch(batch_size, batch);
+        if(batch.empty())
+            break;
+
+        distinct = batch;
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        results.resize(distinct.size());
+
+        pool.p_queries = &distinct;
+        pool.p_results = &results;
+        pool.next_query = 0;
+        pthread_barrier_wait(&pool.start_barrier);
+        answerBatch(&pool);
+        pthread_barrier_wait(&pool.end_barrier);
+
+        out.clear();
+        for(size_t i = 0; i < batch.size(); ++i)
+        {
+            size_t j = std::lower_bound(distinct.begin(), distinct.end(), batch[i]) - distinct.begin();
+            writeResult(batch[i], results[j], out);
+        }
+        fwrite(out.data(), 1, out.size(), stdout);
+
+        num_queries += batch.size();
+        num_distinct += distinct.size();
+    }
+
+    pool.done = true;
+    pthread_barrier_wait(&pool.start_barrier);
+    for(size_t i = 0; i < threads.size(); ++i)
+        pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&pool.start_barrier);
+    pthread_barrier_destroy(&pool.end_barrier);
+
+    double elapsed = getTime() - start_time;
+    fprintf(stderr, "Answered %zu queries (%zu after removing repeats in each batch) with %zu threads in %.2lfs (%.0lf queries/s)\n",
+            num_queries, num_distinct, num_threads, elapsed, elapsed > 0 ? num_queries / elapsed : 0.0);
+
+    if(p_block_cache != NULL)
+    {
+        BlockCacheStats stats = p_block_cache->getStats();
+        size_t lookups = stats.hits + stats.misses;
+        fprintf(stderr, "Block cache: %zu entries, %zu lookups, %.1lf%% hits, %zu evictions, %zu blocks with a $ not cached\n",
+                p_block_cache->getNumEntries(), lookups, lookups > 0 ? 100.0 * stats.hits / lookups : 0.0, 
+                stats.evictions, stats.rejected);
+        index.setBlockCache(NULL);
+        delete p_block_cache;
+    }
+
+    if(!profile_filename.empty())
+    {
+        index.setBlockProfile(NULL);
+        profile.save(profile_filename);
+        fprintf(stderr, "Block profile: %zu block decodes written to %s\n", 
+                (size_t)profile.getTotal(), profile_filename.c_str());
+    }
+    return EXIT_SUCCESS;
+}
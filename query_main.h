@@ -0,0 +1,18 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// query_main - the dbgfm query subcommand, which
+// answers de Bruijn graph queries for a stream of
+// k-mers or sequences using a pool of threads
+// that share one index.
+//
+#ifndef QUERY_MAIN_H
+#define QUERY_MAIN_H
+
+// Run the subcommand. argv[0] is "query".
+int queryMain(int argc, char** argv);
+
+#endif
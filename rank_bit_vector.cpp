@@ -0,0 +1,89 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// RankBitVector - a bitvector supporting constant-time
+// rank queries
+//
+#include "rank_bit_vector.h"
+
+//
+void RankBitVector::initialize(size_t n)
+{
+    m_size = n;
+
+    // Allocate an extra block so the start can be aligned to a cache line
+    size_t num_words = getNumWords(n);
+    m_storage.assign(num_words + RANK_BLOCK_WORDS, 0);
+    mp_mutable = &m_storage[0];
+    mp_mutable += (RANK_BLOCK_WORDS - (reinterpret_cast<size_t>(mp_mutable) / sizeof(uint64_t)) % RANK_BLOCK_WORDS) % RANK_BLOCK_WORDS;
+    mp_words = mp_mutable;
+}
+
+//
+void RankBitVector::set(size_t i)
+{
+    assert(i < m_size && mp_mutable != NULL);
+    uint64_t* p_block = mp_mutable + (i / RANK_BLOCK_BITS) * RANK_BLOCK_WORDS;
+    size_t offset = i % RANK_BLOCK_BITS;
+    p_block[1 + offset / 64] |= 1ULL << (offset % 64);
+}
+
+//
+void RankBitVector::finalize()
+{
+    size_t count = 0;
+    size_t num_words = getNumWords();
+    for(size_t i = 0; i < num_words; i += RANK_BLOCK_WORDS)
+    {
+        mp_mutable[i] = count;
+        for(size_t j = 1; j < RANK_BLOCK_WORDS; ++j)
+            count += __builtin_popcountll(mp_mutable[i + j]);
+    }
+}
+
+//
+void RankBitVector::map(size_t n, const uint64_t* p_words)
+{
+    m_size = n;
+    std::vector<uint64_t>().swap(m_storage);
+    mp_mutable = NULL;
+    mp_words = p_words;
+}
+
+//
+size_t RankBitVector::select1(size_t r) const
+{
+    // Find the last block with fewer than r + 1 set bits before it
+    size_t lower = 0;
+    size_t upper = getNumWords() / RANK_BLOCK_WORDS - 1;
+    while(lower < upper)
+    {
+        size_t mid = (lower + upper + 1) / 2;
+        if(mp_words[mid * RANK_BLOCK_WORDS] <= r)
+            lower = mid;
+        else
+            upper = mid - 1;
+    }
+
+    const uint64_t* p_block = mp_words + lower * RANK_BLOCK_WORDS;
+    r -= p_block[0];
+    for(size_t j = 1; j < RANK_BLOCK_WORDS; ++j)
+    {
+        uint64_t word = p_block[j];
+        size_t count = __builtin_popcountll(word);
+        if(r < count)
+        {
+            // Clear the lower set bits of the word
+            for(size_t k = 0; k < r; ++k)
+                word &= word - 1;
+            return lower * RANK_BLOCK_BITS + (j - 1) * 64 + __builtin_ctzll(word);
+        }
+        r -= count;
+    }
+
+    assert(false);
+    return m_size;
+}
@@ -0,0 +1,127 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// RankBitVector - a bitvector supporting constant-time
+// rank queries. The bits are stored in 64-byte blocks
+// that each begin with the number of set bits preceding
+// the block, so a rank query reads one cache line:
+//   [rank][bits 0-63][bits 64-127]...[bits 384-447]
+// Select is a binary search over the block ranks.
+//
+#ifndef RANK_BIT_VECTOR_H
+#define RANK_BIT_VECTOR_H
+
+#include <vector>
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define RANK_BLOCK_WORDS 8
+#define RANK_BLOCK_BITS ((RANK_BLOCK_WORDS - 1) * 64)
+
+class RankBitVector
+{
+    public:
+        RankBitVector() : m_size(0), mp_mutable(NULL), mp_words(NULL) {}
+
+        // Allocate a vector of n unset bits
+        void initialize(size_t n);
+
+        // Set bit i. Must be called before finalize()
+        void set(size_t i);
+
+        // Compute the rank of each block once all bits are set
+        void finalize();
+
+        // Use a vector stored in an index file. p_words must be 64-byte aligned
+        // for a query to touch a single cache line.
+        void map(size_t n, const uint64_t* p_words);
+
+        // Return bit i
+        inline bool get(size_t i) const
+        {
+            const uint64_t* p_block = mp_words + (i / RANK_BLOCK_BITS) * RANK_BLOCK_WORDS;
+            size_t offset = i % RANK_BLOCK_BITS;
+            return (p_block[1 + offset / 64] >> (offset % 64)) & 1;
+        }
+
+        // Return the number of set bits in [0, i)
+        inline size_t rank1(size_t i) const
+        {
+            const uint64_t* p_block = mp_words + (i / RANK_BLOCK_BITS) * RANK_BLOCK_WORDS;
+            size_t offset = i % RANK_BLOCK_BITS;
+            size_t full_words = offset / 64;
+            size_t count = p_block[0];
+            for(size_t j = 0; j < full_words; ++j)
+                count += __builtin_popcountll(p_block[1 + j]);
+
+            size_t rem = offset % 64;
+            if(rem > 0)
+                count += __builtin_popcountll(p_block[1 + full_words] & ((1ULL << rem) - 1));
+            return count;
+        }
+
+        // Return the number of unset bits in [0, i)
+        inline size_t rank0(size_t i) const { return i - rank1(i); }
+
+        // Return the position of the set bit with rank r, that is
+        // the set bit i with rank1(i) == r. The bit must exist.
+        size_t select1(size_t r) const;
+
+        // Return the last set bit at or before i, or the first set bit at or after i.
+        // The word containing i is checked before falling back to rank and select,
+        // so these are fast when set bits are dense. The bit must exist.
+        inline size_t prev1(size_t i) const
+        {
+            const uint64_t* p_block = mp_words + (i / RANK_BLOCK_BITS) * RANK_BLOCK_WORDS;
+            size_t offset = i % RANK_BLOCK_BITS;
+            uint64_t word = p_block[1 + offset / 64] & (~0ULL >> (63 - offset % 64));
+            if(word != 0)
+                return i - offset % 64 + 63 - __builtin_clzll(word);
+            return select1(rank1(i + 1) - 1);
+        }
+
+        inline size_t next1(size_t i) const
+        {
+            const uint64_t* p_block = mp_words + (i / RANK_BLOCK_BITS) * RANK_BLOCK_WORDS;
+            size_t offset = i % RANK_BLOCK_BITS;
+            uint64_t word = p_block[1 + offset / 64] & (~0ULL << (offset % 64));
+            if(word != 0)
+                return i - offset % 64 + __builtin_ctzll(word);
+            return select1(rank1(i));
+        }
+
+        // Start loading the block containing bit i into the cache
+        inline void prefetch(size_t i) const
+        {
+            __builtin_prefetch(mp_words + (i / RANK_BLOCK_BITS) * RANK_BLOCK_WORDS);
+        }
+
+        inline size_t size() const { return m_size; }
+        inline const uint64_t* getWords() const { return mp_words; }
+        inline size_t getNumWords() const { return getNumWords(m_size); }
+        inline size_t getNumBytes() const { return getNumWords() * sizeof(uint64_t); }
+
+        // Return the number of words needed for a vector of n bits.
+        // There is always a block for position n so rank1(n) is valid.
+        static size_t getNumWords(size_t n) { return (n / RANK_BLOCK_BITS + 1) * RANK_BLOCK_WORDS; }
+
+    private:
+
+        // The vector may point into its own storage so copying is not allowed
+        RankBitVector(const RankBitVector&);
+        RankBitVector& operator=(const RankBitVector&);
+
+        size_t m_size;
+
+        // Storage for a vector built in memory. mp_words points to the
+        // first 64-byte aligned word within it, or into an index file.
+        std::vector<uint64_t> m_storage;
+        uint64_t* mp_mutable;
+        const uint64_t* mp_words;
+};
+
+#endif
@@ -1,9 +1,31 @@
 #!/bin/bash
 set -eu
 
+# Usage: run_bwtdisk.sh reads.fa [reverse] [rc]
+# With "reverse" the BWT of the reversed text is written to <prefix>.rev.bwtdisk,
+# for use as the reverse half of a BidirectionalFMIndex.
+# With "rc" the reverse-complement of every record is indexed as well,
+# for a strand-symmetric index (./dbgfm --rc).
+REVERSE=0
+PREPARE_OPTS=""
+for opt in "${@:2}"; do
+    case $opt in
+        reverse) REVERSE=1 ;;
+        rc) PREPARE_OPTS="--rc" ;;
+        *) echo "Unknown option: $opt" >&2; exit 1 ;;
+    esac
+done
+
 # Prepare the file by concatenating the contigs/sequences into one long string
 # separated by $
-./bwtdisk-prepare $1 > $1.joined
+./bwtdisk-prepare $PREPARE_OPTS $1 > $1.joined
+
+if [ $REVERSE -eq 1 ]; then
+    # bwtdisk constructs the BWT of the reverse text by default so the joined text is used as-is
+    bwte -vvv $1.joined
+    mv $1.joined.bwt `basename $1 .fa`.rev.bwtdisk
+    exit 0
+fi
 
 # Reverse the text, because bwtdisk constructs the BWT of the reverse text by default.
 text_rev -vvv $1.joined $1.joined.rev
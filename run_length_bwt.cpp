@@ -0,0 +1,123 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// RunLengthBWT - a run-length encoded representation
+// of the bwt for highly repetitive collections
+//
+#include <stdlib.h>
+#include <iostream>
+#include <limits>
+#include "run_length_bwt.h"
+#include "bwtdisk_reader.h"
+
+//
+RunLengthBWT::RunLengthBWT() : m_eof_pos(0)
+{
+    memset(&m_info, 0, sizeof(m_info));
+}
+
+//
+void RunLengthBWT::build(const std::string& filename)
+{
+    BWTDiskReader reader(filename);
+    reader.discardHeader();
+
+    // Split the bwt into runs of at most RL_FULL_COUNT symbols,
+    // recording a marker before every RL_MARKER_UNITS units
+    std::vector<RLUnit> units;
+    std::vector<uint64_t> positions;
+    std::vector<AlphaCount64> marker_counts;
+    AlphaCount64 running_count;
+    size_t num_symbols = 0;
+    size_t num_runs = 0;
+
+    RLUnit curr;
+    char b;
+    do
+    {
+        b = reader.readChar();
+        if(curr.isInitialized() && (b == '\n' || b != curr.getChar() || curr.isFull()))
+        {
+            if(units.size() % RL_MARKER_UNITS == 0)
+            {
+                positions.push_back(num_symbols);
+                marker_counts.push_back(running_count);
+            }
+
+            units.push_back(curr);
+            running_count.add(curr.getChar(), curr.getCount());
+            num_symbols += curr.getCount();
+            num_runs += b == '\n' || b != curr.getChar();
+            curr = RLUnit();
+        }
+
+        if(b == '\n')
+            break;
+
+        if(curr.isInitialized())
+            curr.incrementCount();
+        else
+            curr = RLUnit(b);
+    } while(true);
+
+    if(positions.size() > std::numeric_limits<uint32_t>::max())
+    {
+        std::cerr << "Error: the bwt has too many runs for the run-length backend\n";
+        exit(EXIT_FAILURE);
+    }
+
+    // The marker counts are absolute so their widths are bounded by the symbol totals.
+    // No offset is stored as the unit index is implied by the marker index.
+    PackedMarkerVector markers;
+    markers.initialize(marker_counts.size(), running_count, 0);
+    for(size_t i = 0; i < marker_counts.size(); ++i)
+        markers.set(i, marker_counts[i], 0);
+
+    // Sample the lookup table at about the average distance between markers
+    size_t lookup_shift = 0;
+    while((num_symbols >> (lookup_shift + 1)) >= positions.size())
+        ++lookup_shift;
+
+    std::vector<uint32_t> lookup((num_symbols >> lookup_shift) + 1);
+    size_t marker_idx = 0;
+    for(size_t i = 0; i < lookup.size(); ++i)
+    {
+        size_t target = i << lookup_shift;
+        while(marker_idx + 1 < positions.size() && positions[marker_idx + 1] <= target)
+            ++marker_idx;
+        lookup[i] = marker_idx;
+    }
+
+    m_info.num_symbols = num_symbols;
+    m_info.num_units = units.size();
+    m_info.num_runs = num_runs;
+    m_info.num_markers = positions.size();
+    m_info.num_lookup = lookup.size();
+    m_info.lookup_shift = lookup_shift;
+
+    m_units.swap(units);
+    m_positions.swap(positions);
+    m_lookup.swap(lookup);
+    m_markers.swap(markers);
+
+    m_symbolCounts = running_count;
+    m_eof_pos = reader.getEOFPos();
+}
+
+//
+void RunLengthBWT::map(const RunLengthBWTInfo& info,
+                       const RLUnit* p_units,
+                       const uint64_t* p_positions,
+                       const uint32_t* p_lookup,
+                       const PackedMarkerInfo& marker_info,
+                       const uint64_t* p_markers)
+{
+    m_info = info;
+    m_units.map(p_units, info.num_units);
+    m_positions.map(p_positions, info.num_markers);
+    m_lookup.map(p_lookup, info.num_lookup);
+    m_markers.map(marker_info, p_markers);
+}
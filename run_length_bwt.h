@@ -0,0 +1,188 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// RunLengthBWT - a run-length encoded representation
+// of the bwt for highly repetitive collections. The
+// symbols are stored as a string of RLUnits and the
+// size of every structure scales with the number of
+// runs rather than the length of the bwt.
+//
+// A marker is placed every RL_MARKER_UNITS units. It
+// stores the position of the unit in the bwt and the
+// symbol counts before it. To find the marker for a
+// position a lookup table, sampled at a power-of-two
+// interval chosen so it has about as many entries as
+// there are markers, gives a nearby preceding marker.
+//
+#ifndef RUN_LENGTH_BWT_H
+#define RUN_LENGTH_BWT_H
+
+#include <string>
+#include <algorithm>
+#include "sga_rlunit.h"
+#include "fm_markers.h"
+#include "mapped_vector.h"
+
+// One marker per cache line of units
+#define RL_MARKER_UNITS 64
+
+// The parameters of the representation, stored alongside the data in an index file
+struct RunLengthBWTInfo
+{
+    uint64_t num_symbols;
+    uint64_t num_units;
+    uint64_t num_runs;
+    uint64_t num_markers;
+    uint64_t num_lookup;
+    uint64_t lookup_shift;
+};
+
+class RunLengthBWT
+{
+    public:
+        RunLengthBWT();
+
+        // Read the bwt from a bwtdisk file
+        void build(const std::string& filename);
+
+        // Use data stored in an index file
+        void map(const RunLengthBWTInfo& info,
+                 const RLUnit* p_units,
+                 const uint64_t* p_positions,
+                 const uint32_t* p_lookup,
+                 const PackedMarkerInfo& marker_info,
+                 const uint64_t* p_markers);
+
+        // Return the number of times b occurs in bwt[0, n)
+        inline size_t getCount(char b, size_t n) const
+        {
+            size_t marker_idx = getMarkerIndex(n);
+            size_t position = m_positions[marker_idx];
+            size_t unit_idx = marker_idx * RL_MARKER_UNITS;
+            AlphaCount64 counts;
+            size_t unused;
+            m_markers.get(marker_idx, position, counts, unused);
+
+            // Compare the symbol bits of each unit directly to avoid a branch per run
+            size_t count = counts.get(b);
+            uint8_t code = BWT_ALPHABET::getRank(b);
+            while(position < n)
+            {
+                uint8_t data = m_units[unit_idx++].data;
+                size_t run = std::min<size_t>(data & RL_COUNT_MASK, n - position);
+                count += (data >> RL_SYMBOL_SHIFT) == code ? run : 0;
+                position += run;
+            }
+            return count;
+        }
+
+        // Return the number of times each symbol occurs in bwt[0, n)
+        inline AlphaCount64 getFullCount(size_t n) const
+        {
+            size_t marker_idx = getMarkerIndex(n);
+            size_t position = m_positions[marker_idx];
+            size_t unit_idx = marker_idx * RL_MARKER_UNITS;
+            AlphaCount64 counts;
+            size_t unused;
+            m_markers.get(marker_idx, position, counts, unused);
+
+            while(position < n)
+            {
+                const RLUnit& unit = m_units[unit_idx++];
+                size_t run = std::min<size_t>(unit.getCount(), n - position);
+                counts.add(unit.getChar(), run);
+                position += run;
+            }
+            return counts;
+        }
+
+        // Return bwt[idx]
+        inline char getChar(size_t idx) const
+        {
+            size_t marker_idx = getMarkerIndex(idx);
+            size_t position = m_positions[marker_idx];
+            size_t unit_idx = marker_idx * RL_MARKER_UNITS;
+            while(true)
+            {
+                const RLUnit& unit = m_units[unit_idx++];
+                position += unit.getCount();
+                if(position > idx)
+                    return unit.getChar();
+            }
+        }
+
+        // Return bwt[idx] and set count to the number of times it occurs in bwt[0, idx).
+        // The runs before idx are counted while looking for the one containing it.
+        inline char getCharCount(size_t idx, size_t& count) const
+        {
+            size_t marker_idx = getMarkerIndex(idx);
+            size_t position = m_positions[marker_idx];
+            size_t unit_idx = marker_idx * RL_MARKER_UNITS;
+            AlphaCount64 counts;
+            size_t unused;
+            m_markers.get(marker_idx, position, counts, unused);
+
+            while(true)
+            {
+                const RLUnit& unit = m_units[unit_idx++];
+                char b = unit.getChar();
+                size_t run = unit.getCount();
+                if(position + run > idx)
+                {
+                    count = counts.get(b) + idx - position;
+                    return b;
+                }
+                counts.add(b, run);
+                position += run;
+            }
+        }
+
+        // Start loading the lookup entry for position n into the cache.
+        // The marker and units it leads to are not known until it is read.
+        inline void prefetch(size_t n) const
+        {
+            __builtin_prefetch(m_lookup.ptr() + (n >> m_info.lookup_shift));
+        }
+
+        inline const RunLengthBWTInfo& getInfo() const { return m_info; }
+        inline const RLUnit* getUnits() const { return m_units.ptr(); }
+        inline const uint64_t* getPositions() const { return m_positions.ptr(); }
+        inline const uint32_t* getLookup() const { return m_lookup.ptr(); }
+        inline const PackedMarkerVector& getMarkers() const { return m_markers; }
+        inline size_t getNumBytes() const
+        {
+            return m_units.getNumBytes() + m_positions.getNumBytes() + m_lookup.getNumBytes() + m_markers.getNumBytes();
+        }
+
+        // Information from the bwt file, set by build()
+        inline const AlphaCount64& getSymbolCounts() const { return m_symbolCounts; }
+        inline size_t getEOFPos() const { return m_eof_pos; }
+
+    private:
+
+        // Return the index of the last marker at or before position n
+        inline size_t getMarkerIndex(size_t n) const
+        {
+            size_t marker_idx = m_lookup[n >> m_info.lookup_shift];
+            while(marker_idx + 1 < m_info.num_markers && m_positions[marker_idx + 1] <= n)
+                ++marker_idx;
+            return marker_idx;
+        }
+
+        RunLengthBWTInfo m_info;
+        MappedVector<RLUnit> m_units;
+
+        // The position and counts of each marker. The unit index
+        // is implied by the marker index so no offset is stored.
+        MappedVector<uint64_t> m_positions;
+        PackedMarkerVector m_markers;
+        MappedVector<uint32_t> m_lookup;
+
+        AlphaCount64 m_symbolCounts;
+        size_t m_eof_pos;
+};
+
+#endif
@@ -10,6 +10,7 @@
 #ifndef STREAMENCODING_H
 #define STREAMENCODING_H
 
+#include <string.h>
 #include "packed_table_decoder.h"
 #include "utility.h"
 
@@ -19,7 +20,10 @@
 namespace StreamEncode
 {
 
-    // Decode functors for the generic decoding function
+    // Decode functors for the generic decoding function.
+    // Functors used with decodeMulti also accept a multi-symbol table entry.
+    // Those used by the FM-index also accept, through skip(), the counts of
+    // symbols passed over by starting the decode from a block checkpoint.
     struct AlphaCountDecode
     {
         AlphaCountDecode(AlphaCount64& target) : m_target(target) {}
@@ -27,6 +31,16 @@ namespace StreamEncode
         {
             m_target.addByIdx(rank, 1);
         }
+        inline void multi(MULTI_DECODE_TYPE entry)
+        {
+            for(int i = 0; i < BWT_ALPHABET::size; ++i)
+                m_target.addByIdx(i, UNPACK_MULTI_COUNT(entry, i));
+        }
+        inline void skip(const uint16_t* counts)
+        {
+            for(int i = 0; i < BWT_ALPHABET::size; ++i)
+                m_target.addByIdx(i, counts[i]);
+        }
         AlphaCount64& m_target;
     };
 
@@ -40,6 +54,17 @@ namespace StreamEncode
         std::string& m_target;
     };
 
+    // Decoder which writes each symbol to the next position of an array
+    struct SymbolArrayDecode
+    {
+        SymbolArrayDecode(char* pTarget) : m_pTarget(pTarget) {}
+        inline void operator()(int rank)
+        {
+            *m_pTarget++ = BWT_ALPHABET::getChar(rank);
+        }
+        char* m_pTarget;
+    };
+
     struct BaseCountDecode
     {
         BaseCountDecode(char targetBase, size_t& targetCount) : m_targetRank(BWT_ALPHABET::getRank(targetBase)),
@@ -48,10 +73,68 @@ namespace StreamEncode
         {
             m_targetCount += rank == m_targetRank;
         }
+        inline void multi(MULTI_DECODE_TYPE entry)
+        {
+            m_targetCount += UNPACK_MULTI_COUNT(entry, m_targetRank);
+        }
+        inline void skip(const uint16_t* counts)
+        {
+            m_targetCount += counts[(int)m_targetRank];
+        }
         char m_targetRank;
         size_t& m_targetCount;
     };   
 
+    // Decoder which counts every symbol and keeps the rank of the last one, so
+    // a symbol and the number of times it occurs before it are found with one decode
+    struct CharCountDecode
+    {
+        CharCountDecode(AlphaCount64& counts, int& lastRank) : m_counts(counts), m_lastRank(lastRank) {}
+        inline void operator()(int rank)
+        {
+            m_counts.addByIdx(rank, 1);
+            m_lastRank = rank;
+        }
+        inline void multi(MULTI_DECODE_TYPE entry)
+        {
+            for(int i = 0; i < BWT_ALPHABET::size; ++i)
+                m_counts.addByIdx(i, UNPACK_MULTI_COUNT(entry, i));
+            m_lastRank = UNPACK_MULTI_LAST(entry);
+        }
+        inline void skip(const uint16_t* counts)
+        {
+            for(int i = 0; i < BWT_ALPHABET::size; ++i)
+                m_counts.addByIdx(i, counts[i]);
+        }
+        AlphaCount64& m_counts;
+        int& m_lastRank;
+    };
+
+    // Decoder which counts one symbol and keeps the rank of the last symbol
+    struct BaseCountLastDecode
+    {
+        BaseCountLastDecode(char targetBase, size_t& targetCount, int& lastRank) : m_targetRank(BWT_ALPHABET::getRank(targetBase)),
+                                                                                   m_targetCount(targetCount),
+                                                                                   m_lastRank(lastRank) {}
+        inline void operator()(int rank)
+        {
+            m_targetCount += rank == m_targetRank;
+            m_lastRank = rank;
+        }
+        inline void multi(MULTI_DECODE_TYPE entry)
+        {
+            m_targetCount += UNPACK_MULTI_COUNT(entry, m_targetRank);
+            m_lastRank = UNPACK_MULTI_LAST(entry);
+        }
+        inline void skip(const uint16_t* counts)
+        {
+            m_targetCount += counts[(int)m_targetRank];
+        }
+        char m_targetRank;
+        size_t& m_targetCount;
+        int& m_lastRank;
+    };
+
     // Decoder which returns the last base added. This is used to extract a particular character from the stream
     struct SingleBaseDecode
     {
@@ -60,6 +143,11 @@ namespace StreamEncode
         {
             m_base = BWT_ALPHABET::getChar(rank);
         }
+        inline void multi(MULTI_DECODE_TYPE entry)
+        {
+            m_base = BWT_ALPHABET::getChar(UNPACK_MULTI_LAST(entry));
+        }
+        inline void skip(const uint16_t* /*counts*/) {}
         char& m_base;
     };
 
@@ -227,6 +315,85 @@ namespace StreamEncode
         }
         return targetSymbols;
     }    
+
+    // Return the 64 bits of the stream starting at the byte pInput.
+    // Bytes past pEnd are read as zero.
+    inline uint64_t _loadWord(const unsigned char* pInput, const unsigned char* pEnd)
+    {
+        uint64_t word;
+        if(pInput + sizeof(word) <= pEnd + 1)
+        {
+            memcpy(&word, pInput, sizeof(word));
+            return __builtin_bswap64(word);
+        }
+
+        word = 0;
+        for(size_t i = 0; i < sizeof(word); ++i)
+            word = (word << BITS_PER_BYTE) | (pInput + i <= pEnd ? pInput[i] : 0);
+        return word;
+    }
+
+#define MULTI_DECODE_WORD_LOOKUPS 4
+
+    // Decode targetSymbols symbols into the provided functor, like decode(),
+    // but use the multi-symbol table to consume several symbols per lookup.
+    // The stream is read a word at a time from the byte containing the next code.
+    // Decoding starts at bit startBit of pInput. Returns the bit following the
+    // last decoded symbol so a later call can resume from there.
+    template<typename Functor>
+    inline size_t decodeMultiFrom(const PackedTableDecoder& decoder, 
+                                  const unsigned char* pInput, 
+                                  const unsigned char* pEnd, 
+                                  size_t startBit,
+                                  size_t targetSymbols, 
+                                  Functor& functor)
+    {
+        const MULTI_DECODE_TYPE* p_multi_table = decoder.getMultiTable();
+        const PACKED_DECODE_TYPE* p_decode_table = &(*decoder.getTable())[0];
+        int read_length = decoder.getCodeReadLength();
+
+        size_t bit = startBit;
+        while(targetSymbols > 0)
+        {
+            // At least 57 bits of the word are valid after the shift, enough for
+            // MULTI_DECODE_WORD_LOOKUPS lookups before the next load
+            uint64_t word = _loadWord(pInput + bit / BITS_PER_BYTE, pEnd) << (bit % BITS_PER_BYTE);
+            for(int i = 0; i < MULTI_DECODE_WORD_LOOKUPS && targetSymbols > 0; ++i)
+            {
+                MULTI_DECODE_TYPE entry = p_multi_table[word >> (64 - MULTI_DECODE_BITS)];
+                size_t num_symbols = UNPACK_MULTI_SYMBOLS(entry);
+                int bits;
+                if(num_symbols <= targetSymbols)
+                {
+                    functor.multi(entry);
+                    bits = UNPACK_MULTI_BITS(entry);
+                    targetSymbols -= num_symbols;
+                }
+                else
+                {
+                    // Too few symbols remain to use the whole entry so decode one at a time
+                    PACKED_DECODE_TYPE packed_code = p_decode_table[word >> (64 - read_length)];
+                    functor(UNPACK_SYMBOL(packed_code));
+                    bits = UNPACK_BITS(packed_code);
+                    targetSymbols -= 1;
+                }
+                word <<= bits;
+                bit += bits;
+            }
+        }
+        return bit;
+    }
+
+    // Decode targetSymbols symbols from the start of pInput
+    template<typename Functor>
+    inline void decodeMulti(const PackedTableDecoder& decoder, 
+                            const unsigned char* pInput, 
+                            const unsigned char* pEnd, 
+                            size_t targetSymbols, 
+                            Functor& functor)
+    {
+        decodeMultiFrom(decoder, pInput, pEnd, 0, targetSymbols, functor);
+    }
 };
 
 #endif
@@ -0,0 +1,129 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// SuperblockLayout - an alternative memory layout for
+// the huffman-coded bwt
+//
+#include "superblock_layout.h"
+#include "utility.h"
+#include <limits>
+
+//
+SuperblockLayout::SuperblockLayout() : m_superblockBytes(0), m_superShift(0), mp_data(NULL)
+{
+    memset(&m_info, 0, sizeof(m_info));
+}
+
+//
+void SuperblockLayout::build(const uint8_t* p_string,
+                             size_t encoded_end,
+                             const PackedMarkerVector& small_markers,
+                             const PackedMarkerVector& large_markers,
+                             const PackedMarkerVector& reverse_bytes,
+                             size_t small_sample_rate,
+                             size_t large_sample_rate)
+{
+    assert(large_sample_rate >= small_sample_rate);
+    if(large_sample_rate - small_sample_rate > AlphaCount16::getMaxValue())
+    {
+        std::cerr << "Error: the superblock layout requires a large sample rate of at most "
+                  << AlphaCount16::getMaxValue() + small_sample_rate << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    // Unpack the absolute byte offset and relative counts of each block.
+    // When the length of the bwt is a multiple of the small sample rate
+    // the last block is empty and only holds the final counts.
+    size_t num_blocks = small_markers.size();
+    std::vector<AlphaCount64> large_counts(large_markers.size());
+    std::vector<size_t> large_bytes(large_markers.size());
+    for(size_t i = 0; i < large_markers.size(); ++i)
+        large_markers.get(i, i * large_sample_rate, large_counts[i], large_bytes[i]);
+
+    std::vector<size_t> block_start(num_blocks + 1);
+    std::vector<AlphaCount16> small_counts(num_blocks);
+    for(size_t i = 0; i < num_blocks; ++i)
+    {
+        size_t position = i * small_sample_rate;
+        size_t large_idx = position / large_sample_rate;
+
+        AlphaCount64 relative;
+        size_t relative_bytes;
+        small_markers.get(i, position - large_idx * large_sample_rate, relative, relative_bytes);
+        for(size_t j = 0; j < BWT_ALPHABET::size; ++j)
+            small_counts[i].setByIdx(j, relative.getByIdx(j));
+        block_start[i] = large_bytes[large_idx] + relative_bytes;
+    }
+    block_start[num_blocks] = encoded_end;
+
+    // The record stride is the size of the largest block, rounded up to a cache line
+    size_t max_block_bytes = 0;
+    for(size_t i = 0; i < num_blocks; ++i)
+        max_block_bytes = std::max(max_block_bytes, block_start[i + 1] - block_start[i]);
+
+    if(max_block_bytes > std::numeric_limits<uint16_t>::max())
+    {
+        std::cerr << "Error: the superblock layout requires blocks of at most " 
+                  << std::numeric_limits<uint16_t>::max() << " bytes\n";
+        exit(EXIT_FAILURE);
+    }
+
+    size_t record_bytes = SUPERBLOCK_RECORD_HEADER_BYTES + max_block_bytes;
+    m_info.record_stride = (record_bytes + SUPERBLOCK_ALIGNMENT - 1) / SUPERBLOCK_ALIGNMENT * SUPERBLOCK_ALIGNMENT;
+    m_info.blocks_per_superblock = large_sample_rate / small_sample_rate;
+    m_info.num_blocks = num_blocks;
+
+    size_t num_superblocks = (num_blocks + m_info.blocks_per_superblock - 1) / m_info.blocks_per_superblock;
+    size_t superblock_bytes = SUPERBLOCK_HEADER_BYTES + m_info.blocks_per_superblock * m_info.record_stride;
+    m_info.num_bytes = num_superblocks * superblock_bytes;
+
+    // Allocate enough to align the start of the data to a cache line
+    m_storage.assign(m_info.num_bytes + SUPERBLOCK_ALIGNMENT, 0);
+    uint8_t* p_out = &m_storage[0];
+    p_out += (SUPERBLOCK_ALIGNMENT - reinterpret_cast<size_t>(p_out) % SUPERBLOCK_ALIGNMENT) % SUPERBLOCK_ALIGNMENT;
+
+    for(size_t i = 0; i < num_blocks; ++i)
+    {
+        size_t superblock_idx = i / m_info.blocks_per_superblock;
+        size_t record_idx = i % m_info.blocks_per_superblock;
+        uint8_t* p_superblock = p_out + superblock_idx * superblock_bytes;
+
+        // The superblock shares the counts of the large marker it starts at
+        if(record_idx == 0)
+        {
+            const AlphaCount64& large = large_counts[(i * small_sample_rate) / large_sample_rate];
+            memcpy(p_superblock, &large, sizeof(AlphaCount64));
+        }
+
+        uint8_t* p_record = p_superblock + SUPERBLOCK_HEADER_BYTES + record_idx * m_info.record_stride;
+        AlphaCount64 unused;
+        size_t block_reverse_bytes;
+        reverse_bytes.get(i, 0, unused, block_reverse_bytes);
+        uint16_t reverse_offset = block_start[i + 1] - block_start[i] - block_reverse_bytes;
+        memcpy(p_record, &small_counts[i], SUPERBLOCK_RECORD_COUNT_BYTES);
+        memcpy(p_record + SUPERBLOCK_RECORD_COUNT_BYTES, &reverse_offset, sizeof(uint16_t));
+        memcpy(p_record + SUPERBLOCK_RECORD_HEADER_BYTES, p_string + block_start[i], block_start[i + 1] - block_start[i]);
+    }
+
+    mp_data = p_out;
+    initialize();
+}
+
+//
+void SuperblockLayout::map(const SuperblockLayoutInfo& info, const uint8_t* p_data)
+{
+    m_info = info;
+    std::vector<uint8_t>().swap(m_storage);
+    mp_data = p_data;
+    initialize();
+}
+
+//
+void SuperblockLayout::initialize()
+{
+    m_superShift = calculateShiftValue(m_info.blocks_per_superblock);
+    m_superblockBytes = SUPERBLOCK_HEADER_BYTES + m_info.blocks_per_superblock * m_info.record_stride;
+}
@@ -0,0 +1,128 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// SuperblockLayout - an alternative memory layout for
+// the huffman-coded bwt where each small block's
+// relative counts are stored next to its encoded
+// symbols in a 64-byte aligned record. The absolute
+// counts for each group of blocks (a superblock) are
+// stored in a header in front of its records, so
+// a rank query touches one record plus a header
+// that is usually cache resident.
+//
+// Superblock layout:
+//   [header: AlphaCount64, padded to 64 bytes]
+//   [record 0][record 1]...[record n-1]
+// Record layout, padded to the record stride:
+//   [AlphaCount16 relative counts][uint16 reverse offset][encoded symbols]
+// The reverse offset is where the reversed second half of
+// the block starts within the encoded symbols.
+//
+#ifndef SUPERBLOCK_LAYOUT_H
+#define SUPERBLOCK_LAYOUT_H
+
+#include <vector>
+#include "fm_markers.h"
+#include "mapped_vector.h"
+
+#define SUPERBLOCK_ALIGNMENT 64
+#define SUPERBLOCK_HEADER_BYTES 64
+#define SUPERBLOCK_RECORD_COUNT_BYTES sizeof(AlphaCount16)
+#define SUPERBLOCK_RECORD_HEADER_BYTES (SUPERBLOCK_RECORD_COUNT_BYTES + sizeof(uint16_t))
+
+// The parameters of the layout, stored alongside the data in an index file
+struct SuperblockLayoutInfo
+{
+    uint64_t record_stride;
+    uint64_t blocks_per_superblock;
+    uint64_t num_blocks;
+    uint64_t num_bytes;
+};
+
+class SuperblockLayout
+{
+    public:
+        SuperblockLayout();
+
+        // Interleave the markers and encoded string of a huffman-coded bwt.
+        // encoded_end is the number of valid bytes in the string.
+        // reverse_bytes holds the length of the reversed half of each block.
+        void build(const uint8_t* p_string,
+                   size_t encoded_end,
+                   const PackedMarkerVector& small_markers,
+                   const PackedMarkerVector& large_markers,
+                   const PackedMarkerVector& reverse_bytes,
+                   size_t small_sample_rate,
+                   size_t large_sample_rate);
+
+        // Use a layout stored in an index file
+        void map(const SuperblockLayoutInfo& info, const uint8_t* p_data);
+
+        const SuperblockLayoutInfo& getInfo() const { return m_info; }
+
+        // Return the counts before the block and the offset of its encoded
+        // symbols relative to getData()
+        inline LargeMarker getMarker(size_t block_idx) const
+        {
+            size_t record_offset = getRecordOffset(block_idx);
+            size_t superblock_offset = (block_idx >> m_superShift) * m_superblockBytes;
+
+            LargeMarker marker;
+            memcpy(&marker.counts, mp_data + superblock_offset, sizeof(AlphaCount64));
+            AlphaCount16 relative;
+            memcpy(&relative, mp_data + record_offset, sizeof(AlphaCount16));
+            alphacount_add16(marker.counts, relative);
+            marker.byteIndex = record_offset + SUPERBLOCK_RECORD_HEADER_BYTES;
+            return marker;
+        }
+
+        // Return the offset of the reversed half of the block relative to getData()
+        inline size_t getReverseStart(size_t block_idx) const
+        {
+            size_t record_offset = getRecordOffset(block_idx);
+            uint16_t reverse_offset;
+            memcpy(&reverse_offset, mp_data + record_offset + SUPERBLOCK_RECORD_COUNT_BYTES, sizeof(uint16_t));
+            return record_offset + SUPERBLOCK_RECORD_HEADER_BYTES + reverse_offset;
+        }
+
+        // Start loading the superblock header and the record of the block into the cache
+        inline void prefetch(size_t block_idx) const
+        {
+            size_t superblock_idx = block_idx >> m_superShift;
+            size_t record_idx = block_idx & (m_info.blocks_per_superblock - 1);
+            const uint8_t* p_header = mp_data + superblock_idx * m_superblockBytes;
+            const uint8_t* p_record = p_header + SUPERBLOCK_HEADER_BYTES + record_idx * m_info.record_stride;
+            __builtin_prefetch(p_header);
+            for(size_t offset = 0; offset < m_info.record_stride; offset += SUPERBLOCK_ALIGNMENT)
+                __builtin_prefetch(p_record + offset);
+        }
+
+        inline const uint8_t* getData() const { return mp_data; }
+        inline size_t getNumBytes() const { return m_info.num_bytes; }
+
+    private:
+        void initialize();
+
+        // Return the offset of the record for the block relative to getData()
+        inline size_t getRecordOffset(size_t block_idx) const
+        {
+            assert(block_idx < m_info.num_blocks);
+            size_t superblock_idx = block_idx >> m_superShift;
+            size_t record_idx = block_idx & (m_info.blocks_per_superblock - 1);
+            return superblock_idx * m_superblockBytes + SUPERBLOCK_HEADER_BYTES + record_idx * m_info.record_stride;
+        }
+
+        SuperblockLayoutInfo m_info;
+        size_t m_superblockBytes;
+        int m_superShift;
+
+        // Storage for a layout built in memory. mp_data points to the first
+        // aligned byte within it, or into the index file if the layout is mapped.
+        std::vector<uint8_t> m_storage;
+        const uint8_t* mp_data;
+};
+
+#endif
@@ -0,0 +1,82 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// TwoBitBWT - an uncompressed representation of the
+// bwt where each base is stored in two bits
+//
+#include <string.h>
+#include "two_bit_bwt.h"
+#include "bwtdisk_reader.h"
+
+// Add an empty block that is preceded by the given counts
+static void appendBlock(std::vector<uint64_t>& blocks, const AlphaCount64& counts)
+{
+    blocks.push_back(counts.get('$'));
+    blocks.push_back(counts.get('C'));
+    blocks.push_back(counts.get('G'));
+    blocks.push_back(counts.get('T'));
+    blocks.resize(blocks.size() + TWO_BIT_BLOCK_WORDS - TWO_BIT_HEADER_WORDS, 0);
+}
+
+//
+TwoBitBWT::TwoBitBWT() : m_eof_pos(0)
+{
+    memset(&m_info, 0, sizeof(m_info));
+}
+
+//
+void TwoBitBWT::build(const std::string& filename)
+{
+    BWTDiskReader reader(filename);
+    reader.discardHeader();
+
+    std::vector<uint64_t> blocks;
+    std::vector<uint64_t> dollars;
+    AlphaCount64 running_count;
+
+    size_t n = 0;
+    char b;
+    while((b = reader.readChar()) != '\n')
+    {
+        // Start a new block with the counts of the preceding symbols
+        size_t r = n & (TWO_BIT_BLOCK_SYMBOLS - 1);
+        if(r == 0)
+            appendBlock(blocks, running_count);
+
+        if(b == '$')
+            dollars.push_back(n);
+
+        int code = b == '$' ? 0 : BWT_ALPHABET::getRank(b) - 1;
+        uint64_t* p_planes = &blocks[blocks.size() - TWO_BIT_BLOCK_WORDS + TWO_BIT_HEADER_WORDS + 2 * (r >> 6)];
+        p_planes[0] |= uint64_t(code & 1) << (r & 63);
+        p_planes[1] |= uint64_t(code >> 1) << (r & 63);
+
+        running_count.increment(b);
+        ++n;
+    }
+
+    // Counts up to and including the last symbol are needed, so add
+    // a final block if the last symbol ended a block
+    if((n & (TWO_BIT_BLOCK_SYMBOLS - 1)) == 0)
+        appendBlock(blocks, running_count);
+
+    m_info.num_symbols = n;
+    m_info.num_blocks = blocks.size() / TWO_BIT_BLOCK_WORDS;
+    m_info.num_dollars = dollars.size();
+    m_blocks.swap(blocks);
+    m_dollars.swap(dollars);
+
+    m_symbolCounts = running_count;
+    m_eof_pos = reader.getEOFPos();
+}
+
+//
+void TwoBitBWT::map(const TwoBitBWTInfo& info, const uint64_t* p_blocks, const uint64_t* p_dollars)
+{
+    m_info = info;
+    m_blocks.map(p_blocks, info.num_blocks * TWO_BIT_BLOCK_WORDS);
+    m_dollars.map(p_dollars, info.num_dollars);
+}
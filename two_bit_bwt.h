@@ -0,0 +1,190 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// TwoBitBWT - an uncompressed representation of the
+// bwt where each base is stored in two bits. Rank
+// queries are answered with popcounts rather than by
+// decoding a block of symbols, trading memory for speed.
+//
+// The bwt is divided into blocks of 256 symbols. Each
+// block stores the number of $, C, G and T symbols that
+// precede it followed by the low and high bit of each
+// symbol, interleaved 64 symbols at a time:
+//   [$][C][G][T][lo 0][hi 0][lo 1][hi 1]...[lo 3][hi 3]
+// The A count is not stored as it is implied by the
+// position of the block.
+//
+// $ symbols are stored as A in the bit-planes and their
+// positions are kept in a separate sorted list.
+//
+#ifndef TWO_BIT_BWT_H
+#define TWO_BIT_BWT_H
+
+#include <string>
+#include "alphabet.h"
+#include "mapped_vector.h"
+
+#define TWO_BIT_BLOCK_SYMBOLS 256
+#define TWO_BIT_BLOCK_SHIFT 8
+#define TWO_BIT_HEADER_WORDS 4
+#define TWO_BIT_BLOCK_WORDS (TWO_BIT_HEADER_WORDS + 2 * TWO_BIT_BLOCK_SYMBOLS / 64)
+
+// The parameters of the representation, stored alongside the data in an index file
+struct TwoBitBWTInfo
+{
+    uint64_t num_symbols;
+    uint64_t num_blocks;
+    uint64_t num_dollars;
+};
+
+class TwoBitBWT
+{
+    public:
+        TwoBitBWT();
+
+        // Read the bwt from a bwtdisk file
+        void build(const std::string& filename);
+
+        // Use data stored in an index file
+        void map(const TwoBitBWTInfo& info, const uint64_t* p_blocks, const uint64_t* p_dollars);
+
+        // Return the number of times b occurs in bwt[0, n)
+        inline size_t getCount(char b, size_t n) const
+        {
+            size_t block_idx = n >> TWO_BIT_BLOCK_SHIFT;
+            size_t r = n & (TWO_BIT_BLOCK_SYMBOLS - 1);
+            const uint64_t* p_block = &m_blocks[block_idx * TWO_BIT_BLOCK_WORDS];
+
+            if(b == '$')
+                return countDollars(p_block[0], n);
+
+            int code = BWT_ALPHABET::getRank(b) - 1;
+            size_t count = countCode(p_block, code, r);
+            if(code != 0)
+                return p_block[code] + count;
+
+            // Remove the $ symbols within the block, which are stored as A
+            size_t block_dollars = countDollars(p_block[0], n) - p_block[0];
+            return (block_idx << TWO_BIT_BLOCK_SHIFT) - p_block[0] - p_block[1] - p_block[2] - p_block[3] +
+                   count - block_dollars;
+        }
+
+        // Return the number of times each symbol occurs in bwt[0, n)
+        inline AlphaCount64 getFullCount(size_t n) const
+        {
+            size_t block_idx = n >> TWO_BIT_BLOCK_SHIFT;
+            size_t r = n & (TWO_BIT_BLOCK_SYMBOLS - 1);
+            const uint64_t* p_block = &m_blocks[block_idx * TWO_BIT_BLOCK_WORDS];
+
+            size_t dollars = countDollars(p_block[0], n);
+            size_t c = p_block[1] + countCode(p_block, 1, r);
+            size_t g = p_block[2] + countCode(p_block, 2, r);
+            size_t t = p_block[3] + countCode(p_block, 3, r);
+
+            AlphaCount64 counts;
+            counts.set('$', dollars);
+            counts.set('A', n - dollars - c - g - t);
+            counts.set('C', c);
+            counts.set('G', g);
+            counts.set('T', t);
+            return counts;
+        }
+
+        // Returns true if bwt[idx] is b, and then sets count to the number of times
+        // b occurs in bwt[0, idx). The code of b is compared before it is counted.
+        inline bool matchCount(char b, size_t idx, size_t& count) const
+        {
+            const uint64_t* p_block = &m_blocks[(idx >> TWO_BIT_BLOCK_SHIFT) * TWO_BIT_BLOCK_WORDS];
+            size_t r = idx & (TWO_BIT_BLOCK_SYMBOLS - 1);
+            const uint64_t* p_planes = p_block + TWO_BIT_HEADER_WORDS + 2 * (r >> 6);
+            int shift = r & 63;
+            int code = ((p_planes[0] >> shift) & 1) | (((p_planes[1] >> shift) & 1) << 1);
+            int rank = BWT_ALPHABET::getRank(b);
+            if(code != (rank > 0 ? rank - 1 : 0))
+                return false;
+
+            // $ and A share a code
+            if(code == 0 && (getChar(idx) == '$') != (b == '$'))
+                return false;
+            count = getCount(b, idx);
+            return true;
+        }
+
+        // Return bwt[idx]
+        inline char getChar(size_t idx) const
+        {
+            const uint64_t* p_block = &m_blocks[(idx >> TWO_BIT_BLOCK_SHIFT) * TWO_BIT_BLOCK_WORDS];
+            size_t r = idx & (TWO_BIT_BLOCK_SYMBOLS - 1);
+            const uint64_t* p_planes = p_block + TWO_BIT_HEADER_WORDS + 2 * (r >> 6);
+            int shift = r & 63;
+            int code = ((p_planes[0] >> shift) & 1) | (((p_planes[1] >> shift) & 1) << 1);
+            if(code == 0)
+            {
+                size_t k = countDollars(p_block[0], idx);
+                if(k < m_info.num_dollars && m_dollars[k] == idx)
+                    return '$';
+            }
+            return "ACGT"[code];
+        }
+
+        inline const TwoBitBWTInfo& getInfo() const { return m_info; }
+        // Start loading the block containing position n into the cache
+        inline void prefetch(size_t n) const
+        {
+            const uint64_t* p_block = m_blocks.ptr() + (n >> TWO_BIT_BLOCK_SHIFT) * TWO_BIT_BLOCK_WORDS;
+            __builtin_prefetch(p_block);
+            __builtin_prefetch(p_block + TWO_BIT_BLOCK_WORDS - 1);
+        }
+
+        inline const uint64_t* getBlocks() const { return m_blocks.ptr(); }
+        inline const uint64_t* getDollars() const { return m_dollars.ptr(); }
+        inline size_t getNumBytes() const { return m_blocks.getNumBytes() + m_dollars.getNumBytes(); }
+
+        // Information from the bwt file, set by build()
+        inline const AlphaCount64& getSymbolCounts() const { return m_symbolCounts; }
+        inline size_t getEOFPos() const { return m_eof_pos; }
+
+    private:
+
+        // Count the symbols with the given code in the first r symbols of the block
+        inline size_t countCode(const uint64_t* p_block, int code, size_t r) const
+        {
+            const uint64_t* p_planes = p_block + TWO_BIT_HEADER_WORDS;
+            uint64_t lo_flip = code & 1 ? 0 : ~0ULL;
+            uint64_t hi_flip = code & 2 ? 0 : ~0ULL;
+
+            size_t count = 0;
+            size_t full_words = r >> 6;
+            for(size_t i = 0; i < full_words; ++i)
+                count += __builtin_popcountll((p_planes[2 * i] ^ lo_flip) & (p_planes[2 * i + 1] ^ hi_flip));
+
+            size_t rem = r & 63;
+            if(rem > 0)
+            {
+                uint64_t match = (p_planes[2 * full_words] ^ lo_flip) & (p_planes[2 * full_words + 1] ^ hi_flip);
+                count += __builtin_popcountll(match & ((1ULL << rem) - 1));
+            }
+            return count;
+        }
+
+        // Return the number of $ symbols before position n. k is the
+        // number of $ symbols before the block containing n.
+        inline size_t countDollars(size_t k, size_t n) const
+        {
+            while(k < m_info.num_dollars && m_dollars[k] < n)
+                ++k;
+            return k;
+        }
+
+        TwoBitBWTInfo m_info;
+        MappedVector<uint64_t> m_blocks;
+        MappedVector<uint64_t> m_dollars;
+
+        AlphaCount64 m_symbolCounts;
+        size_t m_eof_pos;
+};
+
+#endif
@@ -0,0 +1,182 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// VertexHandle - a k-mer of the de Bruijn graph
+// together with its suffix array intervals
+//
+#include "vertex_handle.h"
+#include "interval_cache.h"
+
+//
+VertexHandle::VertexHandle(const FMIndex* p_index, const std::string& s) : mp_index(p_index),
+                                                                           m_kmer(s),
+                                                                           m_knownIntervals(0)
+{
+    assert(!s.empty());
+}
+
+//
+bool VertexHandle::isVertex() const
+{
+    // The index's k-mer filter, if it has one, rejects most absent k-mers without a search
+    if(!mp_index->getKmerFilter().mayContain(m_kmer))
+        return false;
+
+    // An interval set by a step is checked before searching for the other.
+    // When both strands are indexed either interval answers the query.
+    HandleInterval first = (m_knownIntervals & (1 << HI_RC_KMER)) ? HI_RC_KMER : HI_KMER;
+    const Interval& interval = getInterval(first);
+    if(interval.first <= interval.second)
+        return true;
+    if(mp_index->isStrandSymmetric())
+        return false;
+
+    const Interval& other = getInterval(first == HI_KMER ? HI_RC_KMER : HI_KMER);
+    return other.first <= other.second;
+}
+
+//
+std::string VertexHandle::getSuffixNeighbors() const
+{
+    // The reverse-complement of the neighbor Xb is b'X' so every
+    // neighbor on that strand is a left extension of X'
+    AlphaCount64 rc_extensions = getLeftExtensions(HI_RC_SUFFIX_CORE);
+
+    // Neighbors on the same strand extend X to the right, which a backward
+    // search cannot share, so only the bases not already found are searched.
+    // When both strands are indexed Xb occurs exactly when b'X' does.
+    bool symmetric = mp_index->isStrandSymmetric();
+    std::string x = m_kmer.substr(1);
+    std::string out;
+    for(size_t i = 0; i < 4; ++i)
+    {
+        char b = "ACGT"[i];
+        if(rc_extensions.get(complement(b)) > 0 || (!symmetric && mp_index->count(x + b) > 0))
+            out.append(1, b);
+    }
+    return out;
+}
+
+//
+std::string VertexHandle::getPrefixNeighbors() const
+{
+    // Every neighbor bY on this strand is a left extension of Y
+    AlphaCount64 extensions = getLeftExtensions(HI_PREFIX_CORE);
+
+    // The reverse-complement Y'b' extends Y' to the right so it is searched per base,
+    // unless both strands are indexed
+    bool symmetric = mp_index->isStrandSymmetric();
+    std::string rc_y = reverseComplement(m_kmer.substr(0, m_kmer.size() - 1));
+    std::string out;
+    for(size_t i = 0; i < 4; ++i)
+    {
+        char b = "ACGT"[i];
+        if(extensions.get(b) > 0 || (!symmetric && mp_index->count(rc_y + complement(b)) > 0))
+            out.append(1, b);
+    }
+    return out;
+}
+
+//
+bool VertexHandle::isSuffixNeighbor(char b) const
+{
+    if(getLeftExtensions(HI_RC_SUFFIX_CORE).get(complement(b)) > 0)
+        return true;
+    return !mp_index->isStrandSymmetric() && mp_index->count(m_kmer.substr(1) + b) > 0;
+}
+
+//
+bool VertexHandle::isPrefixNeighbor(char b) const
+{
+    if(getLeftExtensions(HI_PREFIX_CORE).get(b) > 0)
+        return true;
+    std::string rc_y = reverseComplement(m_kmer.substr(0, m_kmer.size() - 1));
+    return !mp_index->isStrandSymmetric() && mp_index->count(rc_y + complement(b)) > 0;
+}
+
+//
+VertexHandle VertexHandle::stepSuffix(char b) const
+{
+    VertexHandle next(mp_index, m_kmer.substr(1) + b);
+
+    // The reverse-complement of Xb is one step from X'
+    Interval interval = getInterval(HI_RC_SUFFIX_CORE);
+    if(interval.first <= interval.second)
+        mp_index->updateInterval(interval.first, interval.second, complement(b));
+    next.setInterval(HI_RC_KMER, interval);
+    return next;
+}
+
+//
+VertexHandle VertexHandle::stepPrefix(char b) const
+{
+    VertexHandle next(mp_index, b + m_kmer.substr(0, m_kmer.size() - 1));
+
+    // bY is one step from Y
+    Interval interval = getInterval(HI_PREFIX_CORE);
+    if(interval.first <= interval.second)
+        mp_index->updateInterval(interval.first, interval.second, b);
+    next.setInterval(HI_KMER, interval);
+    return next;
+}
+
+//
+const VertexHandle::Interval& VertexHandle::getInterval(HandleInterval which) const
+{
+    if(m_knownIntervals & (1 << which))
+        return m_intervals[which];
+
+    std::string s;
+    switch(which)
+    {
+        case HI_KMER:
+            s = m_kmer;
+            break;
+        case HI_RC_KMER:
+            s = reverseComplement(m_kmer);
+            break;
+        case HI_PREFIX_CORE:
+            s = m_kmer.substr(0, m_kmer.size() - 1);
+            break;
+        default:
+            s = reverseComplement(m_kmer.substr(1));
+            break;
+    }
+
+    // The cores are shared by neighboring k-mers so they are
+    // looked up in the index's cache, if it has one, before searching
+    Interval& interval = m_intervals[which];
+    IntervalCache* p_cache = which >= HI_PREFIX_CORE ? mp_index->getIntervalCache() : NULL;
+    if(s.empty())
+    {
+        // Every suffix is in the interval of the empty core of a 1-mer
+        interval = Interval(0, mp_index->getBWLen() - 1);
+    }
+    else if(p_cache == NULL || !p_cache->find(s, interval.first, interval.second))
+    {
+        interval = mp_index->findInterval(s);
+        if(p_cache != NULL)
+            p_cache->insert(s, interval.first, interval.second);
+    }
+    m_knownIntervals |= 1 << which;
+    return m_intervals[which];
+}
+
+//
+void VertexHandle::setInterval(HandleInterval which, const Interval& interval)
+{
+    m_intervals[which] = interval;
+    m_knownIntervals |= 1 << which;
+}
+
+//
+AlphaCount64 VertexHandle::getLeftExtensions(HandleInterval which) const
+{
+    const Interval& interval = getInterval(which);
+    if(interval.first > interval.second)
+        return AlphaCount64();
+    return mp_index->getOccDiff(interval.first - 1, interval.second);
+}
@@ -0,0 +1,96 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// VertexHandle - a k-mer of the de Bruijn graph
+// together with the suffix array intervals needed
+// to answer queries about it, so a traversal does
+// not search the same strings again at every step.
+//
+// Let the k-mer be s = aX = Yc. The handle keeps the
+// intervals of s and of s' (the reverse-complement),
+// and of the (k-1)-mers that the neighbors of s
+// extend to the left: Y, as the prefix neighbors are
+// bY, and X', as the suffix neighbor Xb is b'X' on the
+// other strand. Each of these neighbor sets is read
+// from one rank pair on the interval of the core.
+//
+// Stepping to a neighbor reuses the same intervals:
+// the interval of bY is one backward step from Y and
+// that of b'X' is one backward step from X'. Intervals
+// are computed on first use so a walk in one direction
+// only searches the strings that direction needs. The
+// cores are looked up in the index's IntervalCache, if
+// one is set, before they are searched.
+//
+#ifndef VERTEX_HANDLE_H
+#define VERTEX_HANDLE_H
+
+#include <string>
+#include <utility>
+#include "fm_index.h"
+
+class VertexHandle
+{
+    public:
+
+        // Locate the k-mer s in index. No search is done until a query needs it.
+        VertexHandle(const FMIndex* p_index, const std::string& s);
+
+        // Returns true if the k-mer or its reverse-complement occurs in the index
+        bool isVertex() const;
+
+        // Return the bases b for which Xb, or bY, is a vertex.
+        // See DBGQuery::getSuffixNeighbors.
+        std::string getSuffixNeighbors() const;
+        std::string getPrefixNeighbors() const;
+
+        // Returns true if Xb, or bY, is a vertex
+        bool isSuffixNeighbor(char b) const;
+        bool isPrefixNeighbor(char b) const;
+
+        // Return the number of suffix or prefix neighbors
+        inline size_t getSuffixDegree() const { return getSuffixNeighbors().size(); }
+        inline size_t getPrefixDegree() const { return getPrefixNeighbors().size(); }
+
+        // Return the handle of the neighbor Xb, or bY. The neighbor
+        // does not need to be a vertex.
+        VertexHandle stepSuffix(char b) const;
+        VertexHandle stepPrefix(char b) const;
+
+        inline const std::string& getKmer() const { return m_kmer; }
+
+    private:
+
+        typedef std::pair<size_t, size_t> Interval;
+
+        // The intervals kept by the handle
+        enum HandleInterval
+        {
+            HI_KMER = 0,        // s
+            HI_RC_KMER,         // s'
+            HI_PREFIX_CORE,     // Y
+            HI_RC_SUFFIX_CORE,  // X'
+            HI_NUM_INTERVALS
+        };
+
+        // Return an interval, searching for its string the first time it is used
+        const Interval& getInterval(HandleInterval which) const;
+
+        // Record an interval that is already known
+        void setInterval(HandleInterval which, const Interval& interval);
+
+        // Return the number of times each symbol precedes an occurrence of the core
+        AlphaCount64 getLeftExtensions(HandleInterval which) const;
+
+        const FMIndex* mp_index;
+        std::string m_kmer;
+
+        // The intervals in the order of HandleInterval and a bit for each that is set
+        mutable Interval m_intervals[HI_NUM_INTERVALS];
+        mutable unsigned m_knownIntervals;
+};
+
+#endif
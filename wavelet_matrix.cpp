@@ -0,0 +1,84 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// WaveletMatrix - a representation of the bwt that
+// answers rank and access queries with a fixed number
+// of bitvector ranks
+//
+#include <string.h>
+#include "wavelet_matrix.h"
+#include "bwtdisk_reader.h"
+
+//
+WaveletMatrix::WaveletMatrix() : m_eof_pos(0)
+{
+    memset(&m_info, 0, sizeof(m_info));
+}
+
+//
+void WaveletMatrix::build(const std::string& filename)
+{
+    BWTDiskReader reader(filename);
+    reader.discardHeader();
+
+    // The levels are built by repeatedly partitioning the symbols
+    // so the whole bwt is held in memory, one code per byte
+    std::vector<uint8_t> codes;
+    AlphaCount64 running_count;
+    char b;
+    while((b = reader.readChar()) != '\n')
+    {
+        codes.push_back(BWT_ALPHABET::getRank(b));
+        running_count.increment(b);
+    }
+
+    size_t n = codes.size();
+    m_info.num_symbols = n;
+
+    std::vector<uint8_t> next(n);
+    for(size_t l = 0; l < WM_LEVELS; ++l)
+    {
+        int shift = WM_LEVELS - 1 - l;
+        m_levels[l].initialize(n);
+
+        // Set the bits of this level and stably move the symbols
+        // with a 0 bit in front of those with a 1 bit
+        size_t num_zeros = 0;
+        for(size_t i = 0; i < n; ++i)
+        {
+            if((codes[i] >> shift) & 1)
+                m_levels[l].set(i);
+            else
+                next[num_zeros++] = codes[i];
+        }
+
+        size_t num_ones = num_zeros;
+        for(size_t i = 0; i < n; ++i)
+        {
+            if((codes[i] >> shift) & 1)
+                next[num_ones++] = codes[i];
+        }
+
+        m_levels[l].finalize();
+        m_info.num_zeros[l] = num_zeros;
+        codes.swap(next);
+    }
+
+    // The symbols with code c start at the bottom where position 0 is taken
+    for(size_t c = 0; c < BWT_ALPHABET::size; ++c)
+        m_info.bottom_start[c] = descend(c, 0);
+
+    m_symbolCounts = running_count;
+    m_eof_pos = reader.getEOFPos();
+}
+
+//
+void WaveletMatrix::map(const WaveletMatrixInfo& info, const uint64_t* const* p_levels)
+{
+    m_info = info;
+    for(size_t l = 0; l < WM_LEVELS; ++l)
+        m_levels[l].map(info.num_symbols, p_levels[l]);
+}
@@ -0,0 +1,159 @@
+//-----------------------------------------------
+// Copyright 2013 Wellcome Trust Sanger Institute
+// Written by Jared Simpson (js18@sanger.ac.uk)
+// Released under the GPL
+//-----------------------------------------------
+//
+// WaveletMatrix - a representation of the bwt that
+// answers rank and access queries with a fixed number
+// of bitvector ranks, independent of any sample rate.
+//
+// Each symbol of the 5-letter alphabet is given a
+// 3-bit code. Level l stores bit l of the code of every
+// symbol, most significant bit first, in the order the
+// symbols have after being stably sorted by the bits of
+// the previous levels. The symbols with a 0 bit are
+// placed before those with a 1 bit at the next level.
+//
+// Counting symbol c in [0, n) follows c down the levels
+// from position n. The position reached at the bottom
+// minus the fixed position where c's symbols start there
+// is the count, so a query costs one rank per level.
+//
+#ifndef WAVELET_MATRIX_H
+#define WAVELET_MATRIX_H
+
+#include <string>
+#include "alphabet.h"
+#include "rank_bit_vector.h"
+
+#define WM_LEVELS 3
+
+// The parameters of the matrix, stored alongside the bitvectors in an index file
+struct WaveletMatrixInfo
+{
+    uint64_t num_symbols;
+    uint64_t num_zeros[WM_LEVELS];
+    uint64_t bottom_start[BWT_ALPHABET::size];
+};
+
+class WaveletMatrix
+{
+    public:
+        WaveletMatrix();
+
+        // Read the bwt from a bwtdisk file
+        void build(const std::string& filename);
+
+        // Use the bitvectors of each level stored in an index file
+        void map(const WaveletMatrixInfo& info, const uint64_t* const* p_levels);
+
+        // Return the number of times b occurs in bwt[0, n)
+        inline size_t getCount(char b, size_t n) const
+        {
+            size_t code = BWT_ALPHABET::getRank(b);
+            return descend(code, n) - m_info.bottom_start[code];
+        }
+
+        // Return the number of times each symbol occurs in bwt[0, n).
+        // Symbols that share a code prefix share the ranks of the upper levels.
+        inline AlphaCount64 getFullCount(size_t n) const
+        {
+            // Level 0 splits {$, A, C, G} from {T}
+            size_t r = m_levels[0].rank1(n);
+            size_t p0 = n - r;
+            size_t p1 = m_info.num_zeros[0] + r;
+
+            // Level 1 splits {$, A} from {C, G}. T continues with a 0 bit.
+            r = m_levels[1].rank1(p0);
+            size_t p00 = p0 - r;
+            size_t p01 = m_info.num_zeros[1] + r;
+            size_t p10 = p1 - m_levels[1].rank1(p1);
+
+            // Level 2 separates the remaining pairs
+            AlphaCount64 counts;
+            r = m_levels[2].rank1(p00);
+            counts.setByIdx(0, p00 - r - m_info.bottom_start[0]);
+            counts.setByIdx(1, m_info.num_zeros[2] + r - m_info.bottom_start[1]);
+            r = m_levels[2].rank1(p01);
+            counts.setByIdx(2, p01 - r - m_info.bottom_start[2]);
+            counts.setByIdx(3, m_info.num_zeros[2] + r - m_info.bottom_start[3]);
+            counts.setByIdx(4, p10 - m_levels[2].rank1(p10) - m_info.bottom_start[4]);
+            return counts;
+        }
+
+        // Return bwt[idx]
+        inline char getChar(size_t idx) const
+        {
+            size_t unused;
+            return getCharCount(idx, unused);
+        }
+
+        // Return bwt[idx] and set count to the number of times it occurs in bwt[0, idx).
+        // The path followed to read the symbol is the one getCount follows for it
+        // from idx, so the count is the position reached at the bottom.
+        inline char getCharCount(size_t idx, size_t& count) const
+        {
+            size_t code = 0;
+            for(size_t l = 0; l < WM_LEVELS; ++l)
+            {
+                const RankBitVector& bv = m_levels[l];
+                if(bv.get(idx))
+                {
+                    code = (code << 1) | 1;
+                    idx = m_info.num_zeros[l] + bv.rank1(idx);
+                }
+                else
+                {
+                    code <<= 1;
+                    idx = bv.rank0(idx);
+                }
+            }
+            count = idx - m_info.bottom_start[code];
+            return BWT_ALPHABET::getChar(code);
+        }
+
+        // Start loading the first level's block for position n into the cache.
+        // The positions on the lower levels depend on the ranks above them.
+        inline void prefetch(size_t n) const
+        {
+            m_levels[0].prefetch(n);
+        }
+
+        inline const WaveletMatrixInfo& getInfo() const { return m_info; }
+        inline const RankBitVector& getLevel(size_t l) const { return m_levels[l]; }
+        inline size_t getNumBytes() const
+        {
+            size_t bytes = 0;
+            for(size_t l = 0; l < WM_LEVELS; ++l)
+                bytes += m_levels[l].getNumBytes();
+            return bytes;
+        }
+
+        // Information from the bwt file, set by build()
+        inline const AlphaCount64& getSymbolCounts() const { return m_symbolCounts; }
+        inline size_t getEOFPos() const { return m_eof_pos; }
+
+    private:
+
+        // Follow the symbol with the given code from position n to the bottom level
+        inline size_t descend(size_t code, size_t n) const
+        {
+            for(size_t l = 0; l < WM_LEVELS; ++l)
+            {
+                if((code >> (WM_LEVELS - 1 - l)) & 1)
+                    n = m_info.num_zeros[l] + m_levels[l].rank1(n);
+                else
+                    n = m_levels[l].rank0(n);
+            }
+            return n;
+        }
+
+        WaveletMatrixInfo m_info;
+        RankBitVector m_levels[WM_LEVELS];
+
+        AlphaCount64 m_symbolCounts;
+        size_t m_eof_pos;
+};
+
+#endif